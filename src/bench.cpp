@@ -0,0 +1,385 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <cstdlib>
+#include "game/Bag.h"
+#include "game/Board.h"
+#include "game/Tetrimino.h"
+#include "neat/NEAT.h"
+#include "util/ThreadPool.h"
+
+// Microbenchmarks for the simulation and NEAT hot paths plus end-to-end games/sec and
+// generations/sec, all on fixed seeds so two runs differ only in timing. Every benchmark reports
+// the median and fastest of SAMPLES timed samples, each sized to about SAMPLE_MS, and a checksum
+// of what it computed over CHECKSUM_OPS operations from a rewound corpus cursor, in a separate
+// untimed pass: a checksum that changes between runs means behaviour changed, not speed.
+// The JSON report goes to stdout, and to --out FILE for diffing against an earlier run.
+//
+// usage: bench [--out FILE] [--filter SUBSTRING] [--threads N = 1]
+
+const int SAMPLES = 7;
+const double SAMPLE_MS = 50.0;
+const int CHECKSUM_OPS = 1024;
+const int CORPUS_SEEDS = 8;          // games the board corpus is cut from
+const int CORPUS_EVERY = 10;         // pieces between board snapshots
+const int HIDDEN_SIZES[] = {0, 4, 16, 64};
+const int GAME_SEEDS = 100;          // end-to-end games corpus
+const int MAX_PIECES = 500;
+const int GARBAGE_FREQUENCY = 25;
+const int POP = 100;
+const int GAMES_PER_GENOME = 3;
+const int GENERATIONS = 3;
+
+using Clock = std::chrono::steady_clock;
+
+struct Result {
+    std::string name;
+    long long iterations = 0;  // operations per sample
+    double medianNs = 0, minNs = 0;
+    uint64_t checksum = 0;
+};
+
+std::vector<Result> results;
+std::string filter;
+volatile uint64_t sink; // keeps calibration work observable
+
+// Times op(), which performs one operation and returns a value folded into the checksum.
+// rewind() puts every cursor and generator op() advances back to its start; the checksum is
+// taken right after it, so it depends on neither the calibrated iteration count nor on the
+// benchmarks that ran before. The iteration count is calibrated once so that a sample takes
+// about SAMPLE_MS.
+void bench(const std::string &name, const std::function<void()> &rewind, const std::function<uint64_t()> &op){
+    if(name.find(filter) == std::string::npos) return;
+    rewind();
+    uint64_t checksum = 0;
+    for(int i=0; i<CHECKSUM_OPS; ++i) checksum += op();
+    long long iterations = 1;
+    for(;;){
+        uint64_t sum = 0;
+        auto start = Clock::now();
+        for(long long i=0; i<iterations; ++i) sum += op();
+        sink = sum;
+        double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        if(ms >= SAMPLE_MS / 4 || iterations >= (1LL << 30)){
+            iterations = std::max(1LL, (long long)(iterations * SAMPLE_MS / std::max(ms, 1e-3)));
+            break;
+        }
+        iterations *= 4;
+    }
+    std::vector<double> ns;
+    for(int s=0; s<SAMPLES; ++s){
+        uint64_t sampleSum = 0;
+        auto start = Clock::now();
+        for(long long i=0; i<iterations; ++i) sampleSum += op();
+        ns.push_back(std::chrono::duration<double, std::nano>(Clock::now() - start).count() / iterations);
+        sink = sampleSum;
+    }
+    std::sort(ns.begin(), ns.end());
+    results.push_back({name, iterations, ns[ns.size() / 2], ns[0], checksum});
+    std::cerr << std::left << std::setw(36) << name << std::right << std::fixed << std::setprecision(1)
+              << std::setw(14) << ns[ns.size() / 2] << " ns/op" << std::endl;
+}
+
+// Fixed-weight player on the four placement features (height, holes, bumpiness, lines), good
+// enough to reach the crowded boards evolved players produce.
+int heuristicPick(const PlacementBuffer &placements){
+    int best = -1; double bestScore = -1e18;
+    for(int i=0; i<placements.size(); ++i){
+        double score = -0.51 * placements.aggregateHeight[i] - 0.36 * placements.holes[i]
+                       - 0.18 * placements.bumpiness[i] + 0.76 * placements.clearedLines[i];
+        if(score > bestScore){ bestScore = score; best = i; }
+    }
+    return best;
+}
+
+struct Position {
+    Board board;
+    Tetromino piece;
+};
+
+// Boards from seeded heuristic games every CORPUS_EVERY pieces, each with the piece to place next.
+std::vector<Position> boardCorpus(){
+    std::vector<Position> corpus;
+    PlacementBuffer placements;
+    for(int seed=0; seed<CORPUS_SEEDS; ++seed){
+        Board b;
+        Bag bag(seed);
+        GarbageHoles holes(seed);
+        for(int pieceCount = 1; pieceCount <= MAX_PIECES; ++pieceCount){
+            Tetromino tet(bag.next());
+            if(pieceCount % CORPUS_EVERY == 0) corpus.push_back({b, tet});
+            b.allPossiblePlacements(tet, placements);
+            int best = heuristicPick(placements);
+            if(best < 0) break;
+            b.applyPlacement(placements[best], tet);
+            if(pieceCount % GARBAGE_FREQUENCY == 0) b.addGarbageLine(holes.next(Board::WIDTH));
+            if(b.isGameOver()) break;
+        }
+    }
+    return corpus;
+}
+
+// Corpus boards with a line-clearing placement locked in but not yet cleared.
+std::vector<Board> fullRowCorpus(const std::vector<Position> &corpus){
+    std::vector<Board> boards;
+    PlacementBuffer placements;
+    for(const Position &p : corpus){
+        p.board.allPossiblePlacements(p.piece, placements);
+        for(int i=0; i<placements.size(); ++i){
+            if(!placements.clearedLines[i]) continue;
+            Board b = p.board;
+            b.lock(p.piece, placements.rotation[i], placements.x[i], placements.y[i]);
+            boards.push_back(b);
+            break;
+        }
+    }
+    Board flat; // one full bottom row from four flat I pieces
+    for(int x=0; x<Board::WIDTH; x+=4){
+        Tetromino i(TetrominoType::I);
+        flat.lock(i, 0, x, flat.dropRow(i, 0, x));
+    }
+    boards.push_back(flat);
+    return boards;
+}
+
+// Minimal 4-input genome with `hidden` extra nodes split into it and as many extra links tried.
+neat::Genome grownGenome(int hidden, uint64_t seed){
+    neat::Population seedPop(1, PlacementBuffer::NUM_FEATURES, 1, 7);
+    neat::Genome g = seedPop.genomes[0];
+    neat::StreamRng rng(seed, hidden);
+    int innov = seedPop.globalInnov, nextNode = seedPop.nextNodeId;
+    for(int h=0; h<hidden; ++h){
+        g.addNode(rng, innov, nextNode);
+        g.addConnection(rng, innov);
+    }
+    g.mutateWeights(rng, 0.0);
+    return g;
+}
+
+// Minimal genome wired with the heuristic's weights, for games that last the full MAX_PIECES.
+neat::Genome heuristicGenome(){
+    neat::Population seedPop(1, PlacementBuffer::NUM_FEATURES, 1, 7);
+    neat::Genome g = seedPop.genomes[0];
+    const double weights[] = {-0.51 * 400, -0.36 * 400, -0.18 * 400, 0.76 * 4, 0.0}; // inputs are scaled in PlacementBuffer
+    for(auto &c : g.conns) c.weight = c.in < 5 ? weights[c.in] / 100.0 : 0.0;
+    return g;
+}
+
+struct GameResult {
+    int lines = 0;
+    int pieces = 0;
+};
+
+GameResult playGame(const neat::Phenotype &net, int seed, PlacementBuffer &placements, neat::Activations &act){
+    Board b;
+    Bag bag(seed);
+    GarbageHoles holes(seed);
+    GameResult result;
+    while(result.pieces < MAX_PIECES){
+        Tetromino tet(bag.next());
+        b.canonicalPlacements(tet, placements);
+        if(placements.empty()) break;
+        int bestIdx = net.argmax(placements.featureColumns().data(), PlacementBuffer::NUM_FEATURES, placements.size(), act);
+        if(bestIdx < 0) break;
+        b.applyPlacement(placements[bestIdx], tet);
+        result.lines += placements.clearedLines[bestIdx];
+        if(++result.pieces % GARBAGE_FREQUENCY == 0) b.addGarbageLine(holes.next(Board::WIDTH));
+        if(b.isGameOver()) break;
+    }
+    return result;
+}
+
+std::string jsonEscape(const std::string &s){
+    std::string out;
+    for(char c : s){
+        if(c == '"' || c == '\\') out += '\\';
+        out += c;
+    }
+    return out;
+}
+
+int main(int argc, char **argv){
+    std::string outFile;
+    int threads = 1;
+    for(int i=1; i+1<argc; i+=2){
+        std::string flag = argv[i];
+        if(flag == "--out") outFile = argv[i+1];
+        else if(flag == "--filter") filter = argv[i+1];
+        else if(flag == "--threads") threads = std::max(1, std::atoi(argv[i+1]));
+        else { argc = 0; break; }
+    }
+    if(argc % 2 == 0){
+        std::cerr << "usage: " << argv[0] << " [--out FILE] [--filter SUBSTRING] [--threads N]" << std::endl;
+        return 1;
+    }
+
+    const std::vector<Position> corpus = boardCorpus();
+    const std::vector<Board> fullRows = fullRowCorpus(corpus);
+    // Corpus cursors, shared by the benchmarks below and rewound before each one's checksum.
+    size_t at = 0, fullAt = 0, listAt = 0;
+    auto rewind = [&]{ at = fullAt = listAt = 0; };
+    auto nextPosition = [&]() -> const Position& { const Position &p = corpus[at]; at = at + 1 == corpus.size() ? 0 : at + 1; return p; };
+
+    // --- Board ---
+    bench("board.collides", rewind, [&]{
+        const Position &p = nextPosition();
+        uint64_t hits = 0;
+        for(int r=0; r<p.piece.numStates; ++r)
+            for(int px=-3; px<Board::WIDTH; ++px)
+                for(int py=-2; py<Board::HEIGHT; py+=4) hits += p.board.collides(p.piece, r, px, py);
+        return hits;
+    });
+    bench("board.evaluatePlacement", rewind, [&]{
+        const Position &p = nextPosition();
+        uint64_t sum = 0;
+        for(int r=0; r<p.piece.numStates; ++r)
+            for(int px=-3; px<Board::WIDTH; ++px){
+                Placement pl = p.board.evaluatePlacement(p.piece, r, px);
+                sum += pl.aggregateHeight + pl.holes * 31 + pl.bumpiness * 977;
+            }
+        return sum;
+    });
+    PlacementBuffer placements;
+    bench("board.allPossiblePlacements", rewind, [&]{
+        const Position &p = nextPosition();
+        p.board.allPossiblePlacements(p.piece, placements);
+        return (uint64_t)placements.size();
+    });
+    bench("board.canonicalPlacements", rewind, [&]{
+        const Position &p = nextPosition();
+        p.board.canonicalPlacements(p.piece, placements);
+        return (uint64_t)placements.size();
+    });
+    bench("board.clearLines", rewind, [&]{ // includes one Board copy
+        Board b = fullRows[fullAt];
+        fullAt = fullAt + 1 == fullRows.size() ? 0 : fullAt + 1;
+        return (uint64_t)b.clearLines() + b.hash();
+    });
+
+    // --- Networks, on the candidate lists of the corpus ---
+    std::vector<PlacementBuffer> candidates(corpus.size());
+    for(size_t i=0; i<corpus.size(); ++i) corpus[i].board.allPossiblePlacements(corpus[i].piece, candidates[i]);
+    auto nextList = [&]() -> const PlacementBuffer& { const PlacementBuffer &l = candidates[listAt]; listAt = listAt + 1 == candidates.size() ? 0 : listAt + 1; return l; };
+    std::vector<neat::Genome> sized;
+    for(int hidden : HIDDEN_SIZES) sized.push_back(grownGenome(hidden, 11));
+    neat::Activations act;
+    for(size_t s=0; s<sized.size(); ++s){
+        std::string size = "/h" + std::to_string(HIDDEN_SIZES[s]);
+        const neat::Genome &g = sized[s];
+        std::vector<double> inputs(PlacementBuffer::NUM_FEATURES);
+        bench("genome.evaluate" + size, rewind, [&]{ // every candidate of one move through the reference interpreter
+            const PlacementBuffer &list = nextList();
+            int best = 0; double bestScore = -1e18;
+            for(int i=0; i<list.size(); ++i){
+                for(int f=0; f<PlacementBuffer::NUM_FEATURES; ++f) inputs[f] = list.features[f][i];
+                double score = g.evaluate(inputs);
+                if(score > bestScore){ bestScore = score; best = i; }
+            }
+            return (uint64_t)best;
+        });
+        neat::Phenotype net(g);
+        bench("phenotype.argmax" + size, rewind, [&]{ // the same move as one batched call
+            const PlacementBuffer &list = nextList();
+            return (uint64_t)net.argmax(list.featureColumns().data(), PlacementBuffer::NUM_FEATURES, list.size(), act);
+        });
+        // The same move at each inference precision (train's INFERENCE_PRECISION); --filter precision.
+        for(neat::Precision precision : {neat::Precision::Double, neat::Precision::Float, neat::Precision::Int8}){
+            neat::Phenotype quantized(g, precision);
+            bench(std::string("precision.argmax/") + neat::precisionName(precision) + size, rewind, [&, quantized]{
+                const PlacementBuffer &list = nextList();
+                return (uint64_t)quantized.argmax(list.featureColumns().data(), PlacementBuffer::NUM_FEATURES, list.size(), act);
+            });
+        }
+        neat::Genome other = grownGenome(HIDDEN_SIZES[s], 12), child;
+        neat::StreamRng rng(3, s);
+        bench("genome.crossover" + size, [&]{ rng = neat::StreamRng(3, s); }, [&]{
+            neat::Genome::crossover(g, other, rng, child);
+            return (uint64_t)child.conns.size();
+        });
+    }
+
+    // --- NEAT generation step ---
+    // A fresh generation-0 population every time (construction included): repeated epochs on one
+    // population would keep growing its genomes and drift the timing between samples.
+    bench("population.epoch", []{}, [&]{
+        neat::Population pop(POP, PlacementBuffer::NUM_FEATURES, 1, 5);
+        for(size_t i=0; i<pop.genomes.size(); ++i) pop.genomes[i].fitness = (double)(i * 37 % POP);
+        pop.epoch(4);
+        return (uint64_t)pop.numSpecies() + pop.globalInnov;
+    });
+
+    // --- End to end ---
+    ThreadPool pool(threads);
+    std::vector<PlacementBuffer> buffers(pool.size());
+    std::vector<neat::Activations> activations(pool.size());
+    neat::Phenotype player(heuristicGenome());
+    GameResult corpusTotal;
+    double gamesSec = 0;
+    if(std::string("e2e.games").find(filter) != std::string::npos){
+        std::vector<GameResult> played(GAME_SEEDS);
+        auto start = Clock::now();
+        pool.parallelFor(GAME_SEEDS, [&](int seed, int worker){ played[seed] = playGame(player, seed, buffers[worker], activations[worker]); });
+        gamesSec = std::chrono::duration<double>(Clock::now() - start).count();
+        for(const GameResult &r : played){ corpusTotal.lines += r.lines; corpusTotal.pieces += r.pieces; }
+    }
+    // Generations of the full loop: compile, play GAMES_PER_GENOME seeded games per genome, epoch.
+    neat::Population trainPop(POP, PlacementBuffer::NUM_FEATURES, 1, 9);
+    trainPop.parallelFor = [&pool](int n, const std::function<void(int)> &body){ pool.parallelFor(n, [&body](int i, int){ body(i); }); };
+    long long generationPieces = 0;
+    double generationsSec = 0;
+    if(std::string("e2e.generations").find(filter) != std::string::npos){
+        auto start = Clock::now();
+        for(int gen=0; gen<GENERATIONS; ++gen){
+            std::vector<neat::Phenotype> nets(trainPop.genomes.size());
+            for(size_t i=0; i<nets.size(); ++i) nets[i] = neat::Phenotype(trainPop.genomes[i]);
+            std::vector<GameResult> played(nets.size() * GAMES_PER_GENOME);
+            pool.parallelFor((int)played.size(), [&](int t, int worker){
+                played[t] = playGame(nets[t / GAMES_PER_GENOME], gen * GAMES_PER_GENOME + t % GAMES_PER_GENOME, buffers[worker], activations[worker]);
+            });
+            for(size_t i=0; i<nets.size(); ++i){
+                trainPop.genomes[i].fitness = 0;
+                for(int k=0; k<GAMES_PER_GENOME; ++k){
+                    trainPop.genomes[i].fitness += played[i * GAMES_PER_GENOME + k].lines;
+                    generationPieces += played[i * GAMES_PER_GENOME + k].pieces;
+                }
+            }
+            trainPop.epoch(4);
+        }
+        generationsSec = std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    std::ostringstream json;
+    json << std::fixed << std::setprecision(2);
+    json << "{\n  \"schema\": 1,\n  \"threads\": " << pool.size() << ",\n  \"samples\": " << SAMPLES
+         << ",\n  \"corpus_boards\": " << corpus.size() << ",\n  \"benchmarks\": [";
+    for(size_t i=0; i<results.size(); ++i){
+        const Result &r = results[i];
+        json << (i ? "," : "") << "\n    {\"name\": \"" << jsonEscape(r.name) << "\", \"iterations\": " << r.iterations
+             << ", \"ns_per_op\": " << r.medianNs << ", \"min_ns_per_op\": " << r.minNs
+             << ", \"ops_per_sec\": " << (r.medianNs > 0 ? 1e9 / r.medianNs : 0.0) << ", \"checksum\": " << r.checksum << "}";
+    }
+    json << "\n  ],\n  \"end_to_end\": {";
+    json << "\n    \"games\": {\"seeds\": " << GAME_SEEDS << ", \"seconds\": " << std::setprecision(4) << gamesSec
+         << ", \"games_per_sec\": " << std::setprecision(2) << (gamesSec > 0 ? GAME_SEEDS / gamesSec : 0.0)
+         << ", \"pieces_per_sec\": " << (gamesSec > 0 ? corpusTotal.pieces / gamesSec : 0.0)
+         << ", \"lines\": " << corpusTotal.lines << ", \"pieces\": " << corpusTotal.pieces << "},";
+    json << "\n    \"generations\": {\"population\": " << POP << ", \"generations\": " << GENERATIONS
+         << ", \"seconds\": " << std::setprecision(4) << generationsSec
+         << ", \"generations_per_sec\": " << std::setprecision(2) << (generationsSec > 0 ? GENERATIONS / generationsSec : 0.0)
+         << ", \"pieces\": " << generationPieces << "}";
+    json << "\n  }\n}\n";
+
+    std::cout << json.str();
+    if(!outFile.empty()){
+        std::ofstream out(outFile);
+        out << json.str();
+        if(!out){ std::cerr << "could not write " << outFile << std::endl; return 1; }
+    }
+    return 0;
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <vector>
+#include <random>
+#include <algorithm>
+#include "Tetrimino.h"
+
+// 7-bag randomizer: every run of seven pieces contains each tetromino once.
+class Bag {
+    std::vector<TetrominoType> bag;
+    std::mt19937 rng;
+public:
+    Bag(int seed=123): rng(seed) { refill(); }
+    void refill(){
+        bag = {TetrominoType::I, TetrominoType::O, TetrominoType::T, TetrominoType::L, TetrominoType::J, TetrominoType::S, TetrominoType::Z};
+        std::shuffle(bag.begin(), bag.end(), rng);
+    }
+    TetrominoType next(){
+        if(bag.empty()) refill();
+        TetrominoType t = bag.back(); bag.pop_back();
+        return t;
+    }
+};
+
+// Garbage-line hole columns for one seeded game, drawn independently of the piece sequence.
+class GarbageHoles {
+    std::mt19937 rng;
+public:
+    explicit GarbageHoles(int seed){ std::seed_seq seq{seed, 0x6761}; rng.seed(seq); }
+    int next(int width){ return std::uniform_int_distribution<int>(0, width - 1)(rng); }
+};
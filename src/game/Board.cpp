@@ -1,13 +1,61 @@
 #include "Board.h"
+#include "Features.h"
+#include "util/Profile.h"
 #include <algorithm>
 #include <limits>
 #include <cstring>
 #include <random>
 #include <chrono>
 
-Board::Board(): grid(WIDTH*HEIGHT, 0) {}
+static inline int popcount32(uint32_t v) {
+#if defined(_MSC_VER)
+    return (int)__popcnt(v);
+#else
+    return __builtin_popcount(v);
+#endif
+}
+
+static inline int lowestBit(unsigned v) {
+#if defined(_MSC_VER)
+    unsigned long i; _BitScanForward(&i, v); return (int)i;
+#else
+    return __builtin_ctz(v);
+#endif
+}
+
+// Zobrist keys, one per cell, generated at compile time with splitmix64.
+static constexpr uint64_t splitmix64(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
 
-void Board::clear(){ std::fill(grid.begin(), grid.end(), 0); }
+static constexpr std::array<std::array<uint64_t, Board::WIDTH>, Board::HEIGHT> makeZobrist() {
+    std::array<std::array<uint64_t, Board::WIDTH>, Board::HEIGHT> keys{};
+    for(int y=0; y<Board::HEIGHT; ++y)
+        for(int x=0; x<Board::WIDTH; ++x) keys[y][x] = splitmix64(uint64_t(y * Board::WIDTH + x));
+    return keys;
+}
+
+static constexpr auto ZOBRIST = makeZobrist();
+
+static inline uint64_t rowHash(int y, unsigned row) {
+    uint64_t h = 0;
+    for(; row; row &= row - 1) h ^= ZOBRIST[y][lowestBit(row)];
+    return h;
+}
+
+Board::Board() { clear(); }
+
+void Board::clear(){
+    grid.fill(0);
+    cols.fill(0);
+    colHeight.fill(0);
+    colHoles.fill(0);
+    aggHeight = holeCount = bump = 0;
+    zobrist = 0;
+}
 
 bool Board::isInside(int x,int y) const {
     return x>=0 && x<WIDTH && y>=0 && y<HEIGHT;
@@ -15,117 +63,192 @@ bool Board::isInside(int x,int y) const {
 
 bool Board::isCell(int x,int y) const {
     if(!isInside(x,y)) return false;
-    return grid[y*WIDTH + x] != 0;
+    return (grid[y] >> x) & 1u;
 }
 
 void Board::addGarbageLine() {
-    for (int y = 0; y < HEIGHT - 1; ++y) {
-        for (int x = 0; x < WIDTH; ++x) {
-            grid[y * WIDTH + x] = grid[(y + 1) * WIDTH + x];
-        }
-    }
     std::mt19937 rng(std::chrono::system_clock::now().time_since_epoch().count());
     std::uniform_int_distribution<int> dist(0, WIDTH - 1);
-    int hole_x = dist(rng);
-    for (int x = 0; x < WIDTH; ++x) {
-        grid[(HEIGHT - 1) * WIDTH + x] = (x == hole_x) ? 0 : 1;
+    addGarbageLine(dist(rng));
+}
+
+void Board::addGarbageLine(int hole_x) {
+    std::copy(grid.begin() + 1, grid.end(), grid.begin());
+    grid[HEIGHT - 1] = Row(FULL_ROW & ~(1u << hole_x));
+    for(int x=0; x<WIDTH; ++x){
+        cols[x] >>= 1;
+        if(x != hole_x) cols[x] |= Column(1) << (HEIGHT - 1);
     }
+    refreshAll();
+    rehash();
 }
 
-bool Board::collides(const Tetromino& tet, int rot, int px, int py) const {
-    const int* s = tet.state(rot);
-    int sz = tet.size();
-    for(int by=0; by<sz; ++by){
-        for(int bx=0; bx<sz; ++bx){
-            if(!s[by*sz + bx]) continue;
-            int gx = px + bx;
-            int gy = py + by;
-            if(gx < 0 || gx >= WIDTH || gy >= HEIGHT) return true;
-            if(gy >= 0 && isCell(gx, gy)) return true;
-        }
+// Piece rows moved to column px; cells pushed past either wall are dropped.
+Board::PieceRows Board::shiftedRows(const Tetromino& tet, int rot, int px) {
+    const uint16_t* m = tet.rows(rot);
+    PieceRows out;
+    for(int by=0; by<4; ++by){
+        out[by] = px >= 0 ? Row(m[by] << px) : Row(m[by] >> -px);
+    }
+    return out;
+}
+
+bool Board::fitsHorizontally(const Tetromino& tet, int rot, int px) {
+    return px + tet.left(rot) >= 0 && px + tet.right(rot) < WIDTH;
+}
+
+bool Board::collidesRows(const PieceRows& piece, int py) const {
+    for(int by=0; by<4; ++by){
+        if(!piece[by]) continue;
+        int gy = py + by;
+        if(gy >= HEIGHT) return true;
+        if(gy >= 0 && (grid[gy] & piece[by])) return true;
     }
     return false;
 }
 
+bool Board::collides(const Tetromino& tet, int rot, int px, int py) const {
+    if(!fitsHorizontally(tet, rot, px)) return true;
+    return collidesRows(shiftedRows(tet, rot, px), py);
+}
+
 void Board::lock(const Tetromino& tet, int rot, int px, int py) {
-    const int* s = tet.state(rot);
-    int sz = tet.size();
-    for(int by=0; by<sz; ++by){
-        for(int bx=0; bx<sz; ++bx){
-            if(s[by*sz + bx]){
-                int gx = px + bx;
-                int gy = py + by;
-                if(isInside(gx, gy)) {
-                    grid[gy*WIDTH + gx] = 1;
-                }
-            }
+    PieceRows piece = shiftedRows(tet, rot, px);
+    for(int by=0; by<4; ++by){
+        int gy = py + by;
+        if(gy >= 0 && gy < HEIGHT){
+            zobrist ^= rowHash(gy, piece[by] & ~grid[gy]);
+            grid[gy] |= piece[by];
         }
     }
+    int x0 = std::max(px + tet.left(rot), 0), x1 = std::min(px + tet.right(rot), WIDTH - 1);
+    for(int x=x0; x<=x1; ++x) cols[x] |= pieceColumn(tet, rot, x - px, py);
+    refreshColumns(x0, x1);
 }
 
 int Board::clearLines(){
-    int cleared = 0;
+    uint32_t clearedMask = 0;
     int write_y = HEIGHT-1;
     for(int read_y=HEIGHT-1; read_y>=0; --read_y){
-        bool full = true;
-        for(int x=0;x<WIDTH;++x) if(!isCell(x,read_y)){ full=false; break; }
-        if(full) {
-            ++cleared;
-        } else {
-            if(write_y != read_y){
-                for(int x=0;x<WIDTH;++x) grid[write_y*WIDTH + x] = grid[read_y*WIDTH + x];
-            }
-            --write_y;
-        }
-    }
-    for(int y=write_y; y>=0; --y) {
-        for(int x=0;x<WIDTH;++x) grid[y*WIDTH + x] = 0;
+        if(grid[read_y] != FULL_ROW) grid[write_y--] = grid[read_y];
+        else clearedMask |= 1u << read_y;
     }
+    int cleared = write_y + 1;
+    if(!cleared) return 0;
+    std::fill(grid.begin(), grid.begin() + cleared, Row(0));
+    for(int x=0; x<WIDTH; ++x) cols[x] = removeRows(cols[x], clearedMask);
+    refreshAll();
+    rehash();
     return cleared;
 }
 
-int Board::colHeight(int x) const {
-    for(int y=0;y<HEIGHT;++y){
-        if(isCell(x,y)) return HEIGHT - y;
+// Piece column bx of the given state as board column bits, with the piece's top row at py.
+Board::Column Board::pieceColumn(const Tetromino& tet, int rot, int bx, int py) {
+    Column m = tet.cols(rot)[bx];
+    return py >= 0 ? m << py : m >> -py;
+}
+
+// Drops the rows in rowMask from a column, letting everything above them fall.
+Board::Column Board::removeRows(Column col, uint32_t rowMask) {
+    for(; rowMask; rowMask &= rowMask - 1){
+        Column below = ~((Column(2) << lowestBit(rowMask)) - 1);
+        Column above = (Column(1) << lowestBit(rowMask)) - 1;
+        col = (col & below) | ((col & above) << 1);
     }
-    return 0;
+    return col;
 }
 
-int Board::computeHoles() const {
-    int holes = 0;
-    for(int x=0;x<WIDTH;++x){
-        bool blockSeen = false;
-        for(int y=0;y<HEIGHT;++y){
-            if(isCell(x,y)) blockSeen = true;
-            else if(blockSeen) ++holes;
-        }
+void Board::columnProfile(Column col, int& height, int& holes) {
+    height = col ? HEIGHT - lowestBit(col) : 0;
+    holes = height - popcount32(col);
+}
+
+// Every cell moves on a line clear or garbage push, so the hash is rebuilt from the rows.
+void Board::rehash() {
+    zobrist = 0;
+    for(int y=0; y<HEIGHT; ++y) zobrist ^= rowHash(y, grid[y]);
+}
+
+void Board::refreshAll() {
+    features::Profile prof;
+    features::columnProfile(cols.data(), 0, HEIGHT, prof);
+    colHeight = prof.heights;
+    colHoles = prof.holes;
+    aggHeight = prof.aggregateHeight;
+    holeCount = prof.totalHoles;
+    bump = prof.bumpiness;
+}
+
+// Recomputes the profile of columns x0..x1 and patches the running totals.
+void Board::refreshColumns(int x0, int x1) {
+    if(x0 > x1) return;
+    int lo = std::max(x0 - 1, 0), hi = std::min(x1, WIDTH - 2);
+    for(int x=lo; x<=hi; ++x) bump -= std::abs(colHeight[x] - colHeight[x+1]);
+    for(int x=x0; x<=x1; ++x){
+        aggHeight -= colHeight[x];
+        holeCount -= colHoles[x];
+        columnProfile(cols[x], colHeight[x], colHoles[x]);
+        aggHeight += colHeight[x];
+        holeCount += colHoles[x];
     }
-    return holes;
+    for(int x=lo; x<=hi; ++x) bump += std::abs(colHeight[x] - colHeight[x+1]);
 }
 
-Placement Board::evaluatePlacement(const Tetromino& tet, int rot, int px) const {
-    Board b = *this;
-    int py = -4;
-    for(int testY = -4; testY<HEIGHT; ++testY){
-        if(b.collides(tet, rot, px, testY)){
-            py = testY - 1;
-            break;
-        }
+// Row a piece hard-dropped from above the board comes to rest at: each piece column stops one
+// row above the column surface. Pieces only ever fall straight down, so cells hidden under an
+// overhang can never be reached and the skyline alone is exact; no collision scan is needed.
+// px must keep the piece inside the walls.
+int Board::dropRow(const Tetromino& tet, int rot, int px) const {
+    const int* bottom = tet.bottom(rot);
+    int py = HEIGHT;
+    for(int bx=tet.left(rot); bx<=tet.right(rot); ++bx){
+        if(bottom[bx] < 0) continue;
+        py = std::min(py, HEIGHT - colHeight[px + bx] - 1 - bottom[bx]);
     }
-    if (collides(tet, rot, px, -2)) { // check for spawn collision
+    return py;
+}
+
+// Scores the board as it would look after the drop without copying or touching it.
+// Without a line clear only the columns under the piece change, so the running totals are
+// patched for those; a clear shifts every column, which the feature kernel redoes from the column bits.
+Placement Board::evaluatePlacement(const Tetromino& tet, int rot, int px) const {
+    if (!fitsHorizontally(tet, rot, px) || collides(tet, rot, px, -2)) { // check for spawn collision
         Placement p; p.aggregateHeight = 9999; return p;
     }
+    PieceRows piece = shiftedRows(tet, rot, px);
+    int py = dropRow(tet, rot, px);
+
+    uint32_t clearedMask = 0;
+    for(int by=0; by<4; ++by){
+        int gy = py + by;
+        if(gy >= 0 && gy < HEIGHT && Row(grid[gy] | piece[by]) == FULL_ROW) clearedMask |= 1u << gy;
+    }
+    int cleared = popcount32(clearedMask);
+    int x0 = px + tet.left(rot), x1 = px + tet.right(rot);
 
-    b.lock(tet, rot, px, py);
-    int cleared = b.clearLines();
-    int aggH = 0;
-    std::array<int, WIDTH> heights{};
-    for(int x=0;x<WIDTH;++x){ heights[x] = b.colHeight(x); aggH += heights[x]; }
-    int holes = b.computeHoles();
-    int bump = 0;
-    for(int x=0;x<WIDTH-1;++x) bump += std::abs(heights[x] - heights[x+1]);
+    if(!cleared){
+        std::array<int,4> newHeight;
+        int aggH = aggHeight, holes = holeCount, bumpiness = bump;
+        for(int x=x0; x<=x1; ++x){
+            int h, ho;
+            columnProfile(cols[x] | pieceColumn(tet, rot, x - px, py), h, ho);
+            newHeight[x - x0] = h;
+            aggH += h - colHeight[x];
+            holes += ho - colHoles[x];
+        }
+        auto heightAt = [&](int x){ return (x >= x0 && x <= x1) ? newHeight[x - x0] : colHeight[x]; };
+        for(int x=std::max(x0 - 1, 0); x<=std::min(x1, WIDTH - 2); ++x){
+            bumpiness += std::abs(heightAt(x) - heightAt(x+1)) - std::abs(colHeight[x] - colHeight[x+1]);
+        }
+        return {rot, px, py, 0, aggH, holes, bumpiness};
+    }
+
+    std::array<Column, WIDTH> landed = cols;
+    for(int x=x0; x<=x1; ++x) landed[x] |= pieceColumn(tet, rot, x - px, py);
+    features::Profile prof;
+    features::columnProfile(landed.data(), clearedMask, HEIGHT, prof);
     
-    return {rot, px, py, cleared, aggH, holes, bump};
+    return {rot, px, py, cleared, prof.aggregateHeight, prof.totalHoles, prof.bumpiness};
 }
 
 void Board::applyPlacement(const Placement& pl, const Tetromino& tet){
@@ -134,18 +257,77 @@ void Board::applyPlacement(const Placement& pl, const Tetromino& tet){
 }
 
 bool Board::isGameOver() const {
-    for(int x=0;x<WIDTH;++x) if(isCell(x,0)) return true;
-    return false;
+    return grid[0] != 0;
 }
 
-std::vector<Placement> Board::allPossiblePlacements(const Tetromino& tet) const {
-    std::vector<Placement> out;
+void Board::allPossiblePlacements(const Tetromino& tet, PlacementBuffer& out) const {
+    out.clear();
     for(int r=0; r<tet.numStates; ++r){
         for(int px = -3; px < WIDTH; ++px){
             Placement pl = evaluatePlacement(tet, r, px);
             if(pl.aggregateHeight >= 9999) continue;
-            out.push_back(pl);
+            out.push(pl);
         }
     }
-    return out;
-}
\ No newline at end of file
+    PROFILE_COUNT(PlacementsGenerated, out.size());
+}
+
+// Same candidates as allPossiblePlacements, in the same order, with each distinct resulting
+// board once. Piece states are already distinct shapes and px only walks the state's own
+// bounds, so two placements that lock all four cells without a clear always differ; only line
+// clears and cells cut off above row 0 can collapse different placements onto one board. Those
+// are first compared on their features, which equal boards share, and only rebuilt row by row
+// when the features match, so a move without such a collision never builds a board. The first
+// of a group is kept, so argmax over the list picks the same move as over the full one.
+// On the bench corpus this costs the same as allPossiblePlacements within timing noise; what
+// it saves is the network scoring of the duplicates, which only clear-heavy boards have.
+void Board::canonicalPlacements(const Tetromino& tet, PlacementBuffer& out, EnumerationStats* stats) const {
+    out.clear();
+    // Emitted candidates that clear or stick out, and their resulting rows once built.
+    std::array<std::array<Row,HEIGHT>, PlacementBuffer::CAPACITY> collapsed;
+    std::array<int, PlacementBuffer::CAPACITY> collapsedIndex;
+    std::array<bool, PlacementBuffer::CAPACITY> built;
+    int numCollapsed = 0;
+    uint64_t duplicates = 0;
+    auto rowsAfter = [&](int r, int px, int py, std::array<Row,HEIGHT>& rows){
+        PieceRows piece = shiftedRows(tet, r, px);
+        int write_y = HEIGHT - 1;
+        for(int y=HEIGHT-1; y>=0; --y){
+            Row row = grid[y];
+            if(y >= py && y < py + 4) row |= piece[y - py];
+            if(row != FULL_ROW) rows[write_y--] = row;
+        }
+        std::fill(rows.begin(), rows.begin() + write_y + 1, Row(0));
+    };
+    for(int r=0; r<tet.numStates; ++r){
+        for(int px = -tet.left(r); px <= WIDTH - 1 - tet.right(r); ++px){
+            Placement pl = evaluatePlacement(tet, r, px);
+            if(pl.aggregateHeight >= 9999) continue;
+            if(pl.clearedLines || pl.y < 0){
+                std::array<Row,HEIGHT> rows;
+                bool haveRows = false, duplicate = false;
+                for(int k=0; k<numCollapsed && !duplicate; ++k){
+                    int i = collapsedIndex[k];
+                    if(out.aggregateHeight[i] != pl.aggregateHeight || out.holes[i] != pl.holes || out.bumpiness[i] != pl.bumpiness) continue;
+                    if(!haveRows){ rowsAfter(r, px, pl.y, rows); haveRows = true; }
+                    if(!built[k]){ rowsAfter(out.rotation[i], out.x[i], out.y[i], collapsed[k]); built[k] = true; }
+                    duplicate = collapsed[k] == rows;
+                }
+                if(duplicate){
+                    ++duplicates;
+                    continue;
+                }
+                collapsedIndex[numCollapsed] = out.size();
+                built[numCollapsed] = haveRows;
+                if(haveRows) collapsed[numCollapsed] = rows;
+                ++numCollapsed;
+            }
+            out.push(pl);
+        }
+    }
+    PROFILE_COUNT(PlacementsGenerated, out.size());
+    if(stats){
+        stats->reference += out.size() + duplicates;
+        stats->emitted += out.size();
+    }
+}
@@ -1,6 +1,6 @@
 #pragma once
-#include <vector>
-#include <optional>
+#include <array>
+#include <cstdint>
 #include "Tetrimino.h"
 
 struct Placement {
@@ -13,10 +13,31 @@ struct Placement {
     int bumpiness;
 };
 
+struct PlacementBuffer;
+
+// Board::canonicalPlacements output against what allPossiblePlacements would have listed for the
+// same calls. Accumulates over calls.
+struct EnumerationStats {
+    uint64_t reference = 0; // placements allPossiblePlacements lists
+    uint64_t emitted = 0;
+    // Placements left out for reaching the same board as an earlier one (line clears, or cells above the top).
+    uint64_t duplicates() const { return reference - emitted; }
+};
+
+// Bitboard: one uint16_t per row, bit x set when column x is filled, row 0 at the top.
+// A transposed copy (one uint32_t per column, bit y set when row y is filled) keeps the
+// per-column height/hole profile cheap to maintain as pieces lock and lines clear.
 class Board {
 public:
     static constexpr int WIDTH = 16;
     static constexpr int HEIGHT = 22;
+    using Row = uint16_t;
+    using Column = uint32_t;
+    using PieceRows = std::array<Row,4>;
+    static constexpr Row FULL_ROW = 0xFFFF;
+    static_assert(WIDTH == 16, "a board row must fill exactly one uint16_t");
+    static_assert(HEIGHT < 24, "feature kernels convert column bits to float exactly");
+
     Board();
     void clear();
     bool isInside(int x,int y) const;
@@ -24,14 +45,80 @@ public:
     bool collides(const Tetromino& tet, int rot, int px, int py) const;
     void lock(const Tetromino& tet, int rot, int px, int py);
     int clearLines();
-    void addGarbageLine();
+    void addGarbageLine();          // hole column drawn from the clock: not reproducible
+    void addGarbageLine(int holeX); // deterministic version for seeded games
+    int dropRow(const Tetromino& tet, int rot, int px) const;
     Placement evaluatePlacement(const Tetromino& tet, int rot, int px) const;
     void applyPlacement(const Placement& pl, const Tetromino& tet);
     bool isGameOver() const;
-    std::vector<Placement> allPossiblePlacements(const Tetromino& tet) const;
-    const std::vector<int>& cells() const { return grid; }
+    void allPossiblePlacements(const Tetromino& tet, PlacementBuffer& out) const;
+    void canonicalPlacements(const Tetromino& tet, PlacementBuffer& out, EnumerationStats* stats = nullptr) const;
+    const std::array<Row,HEIGHT>& rows() const { return grid; }
+    const std::array<int,WIDTH>& heights() const { return colHeight; }
+    int aggregateHeight() const { return aggHeight; }
+    int holes() const { return holeCount; }
+    int bumpiness() const { return bump; }
+    // Zobrist hash of the filled cells, kept up to date by every mutation.
+    uint64_t hash() const { return zobrist; }
 private:
-    std::vector<int> grid;
-    int colHeight(int x) const;
-    int computeHoles() const;
-};
\ No newline at end of file
+    std::array<Row,HEIGHT> grid;
+    std::array<Column,WIDTH> cols;
+    std::array<int,WIDTH> colHeight;
+    std::array<int,WIDTH> colHoles;
+    int aggHeight;
+    int holeCount;
+    int bump;
+    uint64_t zobrist;
+    static Column pieceColumn(const Tetromino& tet, int rot, int bx, int py);
+    static Column removeRows(Column col, uint32_t rowMask);
+    static void columnProfile(Column col, int& height, int& holes);
+    void refreshColumns(int x0, int x1);
+    void refreshAll();
+    void rehash();
+    static PieceRows shiftedRows(const Tetromino& tet, int rot, int px);
+    static bool fitsHorizontally(const Tetromino& tet, int rot, int px);
+    bool collidesRows(const PieceRows& piece, int py) const;
+};
+
+// Caller-owned candidate list in structure-of-arrays form, filled in place by
+// Board::allPossiblePlacements and reused across moves and games so move generation never
+// allocates. The network inputs for each candidate sit next to it, one contiguous column per feature.
+struct PlacementBuffer {
+    static constexpr int CAPACITY = 4 * (Board::WIDTH + 3);
+    static constexpr int NUM_FEATURES = 4;
+    int count = 0;
+    std::array<int8_t,CAPACITY> rotation;
+    std::array<int8_t,CAPACITY> x;
+    std::array<int8_t,CAPACITY> y;
+    std::array<int8_t,CAPACITY> clearedLines;
+    std::array<int16_t,CAPACITY> aggregateHeight;
+    std::array<int16_t,CAPACITY> holes;
+    std::array<int16_t,CAPACITY> bumpiness;
+    std::array<std::array<double,CAPACITY>,NUM_FEATURES> features;
+
+    void clear() { count = 0; }
+    bool empty() const { return count == 0; }
+    int size() const { return count; }
+    void push(const Placement& p) {
+        rotation[count] = int8_t(p.rotation);
+        x[count] = int8_t(p.x);
+        y[count] = int8_t(p.y);
+        clearedLines[count] = int8_t(p.clearedLines);
+        aggregateHeight[count] = int16_t(p.aggregateHeight);
+        holes[count] = int16_t(p.holes);
+        bumpiness[count] = int16_t(p.bumpiness);
+        features[0][count] = p.aggregateHeight / 400.0;
+        features[1][count] = p.holes / 400.0;
+        features[2][count] = p.bumpiness / 400.0;
+        features[3][count] = p.clearedLines / 4.0;
+        ++count;
+    }
+    std::array<const double*,NUM_FEATURES> featureColumns() const {
+        std::array<const double*,NUM_FEATURES> cols;
+        for(int f=0; f<NUM_FEATURES; ++f) cols[f] = features[f].data();
+        return cols;
+    }
+    Placement operator[](int i) const {
+        return {rotation[i], x[i], y[i], clearedLines[i], aggregateHeight[i], holes[i], bumpiness[i]};
+    }
+};
@@ -0,0 +1,233 @@
+#include "Features.h"
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define FEATURES_X86 1
+#include <immintrin.h>
+#endif
+
+namespace features {
+
+static inline int lowestBit(uint32_t v) {
+#if defined(_MSC_VER)
+    unsigned long i; _BitScanForward(&i, v); return (int)i;
+#else
+    return __builtin_ctz(v);
+#endif
+}
+
+static inline int popcount32(uint32_t v) {
+#if defined(_MSC_VER)
+    return (int)__popcnt(v);
+#else
+    return __builtin_popcount(v);
+#endif
+}
+
+void scalarKernel(const uint32_t* cols, uint32_t clearedMask, int boardHeight, Profile& out) {
+    out.aggregateHeight = out.totalHoles = out.bumpiness = 0;
+    for(int x=0; x<COLUMNS; ++x){
+        uint32_t col = cols[x];
+        for(uint32_t m = clearedMask; m; m &= m - 1){
+            uint32_t bit = m & (0u - m);
+            col = (col & ~(bit*2 - 1)) | ((col & (bit - 1)) << 1);
+        }
+        out.heights[x] = col ? boardHeight - lowestBit(col) : 0;
+        out.holes[x] = out.heights[x] - popcount32(col);
+        out.aggregateHeight += out.heights[x];
+        out.totalHoles += out.holes[x];
+    }
+    for(int x=0; x<COLUMNS-1; ++x) out.bumpiness += std::abs(out.heights[x] - out.heights[x+1]);
+}
+
+#ifdef FEATURES_X86
+
+// ctz of each lane from the float exponent of its lowest set bit; lanes are < 2^24 so the
+// conversion is exact. Empty lanes are masked out by the caller.
+__attribute__((target("avx2")))
+static inline __m256i ctz8(__m256i c) {
+    __m256i lowest = _mm256_and_si256(c, _mm256_sub_epi32(_mm256_setzero_si256(), c));
+    __m256i bits = _mm256_castps_si256(_mm256_cvtepi32_ps(lowest));
+    return _mm256_sub_epi32(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(127));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i popcount8(__m256i c) {
+    const __m256i lut = _mm256_setr_epi8(0,1,1,2,1,2,2,3,1,2,2,3,2,3,3,4, 0,1,1,2,1,2,2,3,1,2,2,3,2,3,3,4);
+    const __m256i low4 = _mm256_set1_epi8(0x0F);
+    __m256i bytes = _mm256_add_epi8(_mm256_shuffle_epi8(lut, _mm256_and_si256(c, low4)),
+                                    _mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi32(c, 4), low4)));
+    return _mm256_madd_epi16(_mm256_maddubs_epi16(bytes, _mm256_set1_epi8(1)), _mm256_set1_epi16(1));
+}
+
+__attribute__((target("avx2")))
+static inline int hsum8(__m256i v) {
+    __m128i s = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(1,0,3,2)));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(2,3,0,1)));
+    return _mm_cvtsi128_si32(s);
+}
+
+__attribute__((target("avx2")))
+static void avx2Kernel(const uint32_t* cols, uint32_t clearedMask, int boardHeight, Profile& out) {
+    __m256i c[2] = { _mm256_loadu_si256((const __m256i*)cols), _mm256_loadu_si256((const __m256i*)(cols + 8)) };
+    for(; clearedMask; clearedMask &= clearedMask - 1){
+        uint32_t bit = clearedMask & (0u - clearedMask);
+        __m256i above = _mm256_set1_epi32(int(bit - 1));
+        __m256i below = _mm256_set1_epi32(int(~(bit*2 - 1)));
+        for(auto& v : c) v = _mm256_or_si256(_mm256_and_si256(v, below), _mm256_slli_epi32(_mm256_and_si256(v, above), 1));
+    }
+    const __m256i zero = _mm256_setzero_si256(), height = _mm256_set1_epi32(boardHeight);
+    __m256i aggH = zero, holes = zero;
+    for(int i=0; i<2; ++i){
+        __m256i h = _mm256_andnot_si256(_mm256_cmpeq_epi32(c[i], zero), _mm256_sub_epi32(height, ctz8(c[i])));
+        __m256i ho = _mm256_sub_epi32(h, popcount8(c[i]));
+        _mm256_storeu_si256((__m256i*)(out.heights.data() + 8*i), h);
+        _mm256_storeu_si256((__m256i*)(out.holes.data() + 8*i), ho);
+        aggH = _mm256_add_epi32(aggH, h);
+        holes = _mm256_add_epi32(holes, ho);
+    }
+    alignas(32) int padded[COLUMNS + 8];
+    _mm256_store_si256((__m256i*)padded, _mm256_loadu_si256((const __m256i*)out.heights.data()));
+    _mm256_store_si256((__m256i*)(padded + 8), _mm256_loadu_si256((const __m256i*)(out.heights.data() + 8)));
+    padded[COLUMNS] = padded[COLUMNS - 1];
+    __m256i bump = _mm256_add_epi32(
+        _mm256_abs_epi32(_mm256_sub_epi32(_mm256_load_si256((const __m256i*)padded), _mm256_loadu_si256((const __m256i*)(padded + 1)))),
+        _mm256_abs_epi32(_mm256_sub_epi32(_mm256_load_si256((const __m256i*)(padded + 8)), _mm256_loadu_si256((const __m256i*)(padded + 9)))));
+    out.aggregateHeight = hsum8(aggH);
+    out.totalHoles = hsum8(holes);
+    out.bumpiness = hsum8(bump);
+}
+
+// SSE2 is part of every x86-64 CPU, so this needs no pshufb/abs/min: SWAR popcount and a
+// sign-mask abs instead.
+__attribute__((target("sse2")))
+static inline __m128i ctz4(__m128i c) {
+    __m128i lowest = _mm_and_si128(c, _mm_sub_epi32(_mm_setzero_si128(), c));
+    __m128i bits = _mm_castps_si128(_mm_cvtepi32_ps(lowest));
+    return _mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(127));
+}
+
+__attribute__((target("sse2")))
+static inline __m128i popcount4(__m128i v) {
+    v = _mm_sub_epi32(v, _mm_and_si128(_mm_srli_epi32(v, 1), _mm_set1_epi32(0x55555555)));
+    v = _mm_add_epi32(_mm_and_si128(v, _mm_set1_epi32(0x33333333)), _mm_and_si128(_mm_srli_epi32(v, 2), _mm_set1_epi32(0x33333333)));
+    v = _mm_and_si128(_mm_add_epi32(v, _mm_srli_epi32(v, 4)), _mm_set1_epi32(0x0F0F0F0F));
+    v = _mm_add_epi32(v, _mm_srli_epi32(v, 8));
+    v = _mm_add_epi32(v, _mm_srli_epi32(v, 16));
+    return _mm_and_si128(v, _mm_set1_epi32(0x3F));
+}
+
+__attribute__((target("sse2")))
+static inline __m128i abs4(__m128i v) {
+    __m128i sign = _mm_srai_epi32(v, 31);
+    return _mm_sub_epi32(_mm_xor_si128(v, sign), sign);
+}
+
+__attribute__((target("sse2")))
+static inline int hsum4(__m128i s) {
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(1,0,3,2)));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(2,3,0,1)));
+    return _mm_cvtsi128_si32(s);
+}
+
+__attribute__((target("sse2")))
+static void sse2Kernel(const uint32_t* cols, uint32_t clearedMask, int boardHeight, Profile& out) {
+    __m128i c[4];
+    for(int i=0; i<4; ++i) c[i] = _mm_loadu_si128((const __m128i*)(cols + 4*i));
+    for(; clearedMask; clearedMask &= clearedMask - 1){
+        uint32_t bit = clearedMask & (0u - clearedMask);
+        __m128i above = _mm_set1_epi32(int(bit - 1));
+        __m128i below = _mm_set1_epi32(int(~(bit*2 - 1)));
+        for(auto& v : c) v = _mm_or_si128(_mm_and_si128(v, below), _mm_slli_epi32(_mm_and_si128(v, above), 1));
+    }
+    const __m128i zero = _mm_setzero_si128(), height = _mm_set1_epi32(boardHeight);
+    __m128i aggH = zero, holes = zero;
+    for(int i=0; i<4; ++i){
+        __m128i h = _mm_andnot_si128(_mm_cmpeq_epi32(c[i], zero), _mm_sub_epi32(height, ctz4(c[i])));
+        __m128i ho = _mm_sub_epi32(h, popcount4(c[i]));
+        _mm_storeu_si128((__m128i*)(out.heights.data() + 4*i), h);
+        _mm_storeu_si128((__m128i*)(out.holes.data() + 4*i), ho);
+        aggH = _mm_add_epi32(aggH, h);
+        holes = _mm_add_epi32(holes, ho);
+    }
+    int padded[COLUMNS + 4];
+    for(int x=0; x<COLUMNS; ++x) padded[x] = out.heights[x];
+    padded[COLUMNS] = padded[COLUMNS - 1];
+    __m128i bump = zero;
+    for(int i=0; i<4; ++i){
+        __m128i a = _mm_loadu_si128((const __m128i*)(padded + 4*i));
+        __m128i b = _mm_loadu_si128((const __m128i*)(padded + 4*i + 1));
+        bump = _mm_add_epi32(bump, abs4(_mm_sub_epi32(a, b)));
+    }
+    out.aggregateHeight = hsum4(aggH);
+    out.totalHoles = hsum4(holes);
+    out.bumpiness = hsum4(bump);
+}
+
+#endif
+
+// Smoke check against the scalar reference before a kernel is first used: a few random boards
+// cycling through the fill levels and up to four cleared rows, cheap enough for startup. The full
+// differential test is tests/features_test.cpp. Returns "" or a description of the first mismatch.
+static std::string disagreementWithScalar(Kernel k) {
+    const int boardHeight = 22, trials = 2 * (boardHeight + 1);
+    std::mt19937 rng(12345);
+    for(int trial=0; trial<trials; ++trial){
+        uint32_t cols[COLUMNS];
+        int surface = trial % (boardHeight + 1);
+        for(auto& col : cols){
+            col = rng() & ((1u << boardHeight) - 1);
+            col &= ~((1u << (rng() % (surface + 1))) - 1);
+        }
+        uint32_t cleared = 0;
+        for(int n = trial % 5; n > 0; --n) cleared |= 1u << (rng() % boardHeight);
+        Profile want, got;
+        scalarKernel(cols, cleared, boardHeight, want);
+        k(cols, cleared, boardHeight, got);
+        if(want.heights != got.heights || want.holes != got.holes || want.aggregateHeight != got.aggregateHeight
+           || want.totalHoles != got.totalHoles || want.bumpiness != got.bumpiness){
+            std::ostringstream why;
+            why << "trial " << trial << ", cleared rows 0x" << std::hex << cleared << std::dec << ": aggregate height "
+                << got.aggregateHeight << " vs " << want.aggregateHeight << ", holes " << got.totalHoles << " vs "
+                << want.totalHoles << ", bumpiness " << got.bumpiness << " vs " << want.bumpiness;
+            return why.str();
+        }
+    }
+    return std::string();
+}
+
+struct Selected { Kernel kernel; const char* name; };
+
+std::vector<NamedKernel> simdKernels() {
+    std::vector<NamedKernel> kernels;
+#ifdef FEATURES_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2")) kernels.push_back({avx2Kernel, "avx2"});
+    if(__builtin_cpu_supports("sse2")) kernels.push_back({sse2Kernel, "sse2"});
+#endif
+    return kernels;
+}
+
+static Selected select() {
+    for(const NamedKernel& k : simdKernels()){
+        std::string why = disagreementWithScalar(k.kernel);
+        if(why.empty()) return {k.kernel, k.name};
+        std::cerr << "features: " << k.name << " kernel disagrees with scalar (" << why << "), not used" << std::endl;
+    }
+    return {scalarKernel, "scalar"};
+}
+
+static const Selected& selected() {
+    static const Selected s = select();
+    return s;
+}
+
+Kernel kernel() { return selected().kernel; }
+const char* kernelName() { return selected().name; }
+
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <vector>
+
+// Board feature kernels over the 16 transposed board columns (bit y of a column set when row y
+// is filled, row 0 at the top). The widest kernel the CPU supports is picked at first use and
+// checked against the scalar reference before it is trusted; a kernel that disagrees is reported on
+// stderr and the next narrower one is tried, down to scalar.
+namespace features {
+    constexpr int COLUMNS = 16;
+
+    struct Profile {
+        std::array<int,COLUMNS> heights;
+        std::array<int,COLUMNS> holes;
+        int aggregateHeight;
+        int totalHoles;
+        int bumpiness;
+    };
+
+    // Profile of the columns after dropping the rows set in clearedMask, on a board of boardHeight rows.
+    using Kernel = void (*)(const uint32_t* cols, uint32_t clearedMask, int boardHeight, Profile& out);
+
+    void scalarKernel(const uint32_t* cols, uint32_t clearedMask, int boardHeight, Profile& out);
+
+    Kernel kernel();
+    const char* kernelName();
+
+    // Every SIMD kernel this CPU can run, widest first, whether or not kernel() trusted it.
+    struct NamedKernel { Kernel kernel; const char* name; };
+    std::vector<NamedKernel> simdKernels();
+
+    inline void columnProfile(const uint32_t* cols, uint32_t clearedMask, int boardHeight, Profile& out) {
+        kernel()(cols, clearedMask, boardHeight, out);
+    }
+}
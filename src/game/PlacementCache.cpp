@@ -0,0 +1,71 @@
+#include "PlacementCache.h"
+#include <algorithm>
+
+PlacementCache::PlacementCache(size_t capacity, int shardCount)
+    : sets(std::max<size_t>(1, capacity / std::max(shardCount, 1) / WAYS)) {
+    for(int i=0; i<std::max(shardCount, 1); ++i){
+        shards.push_back(std::make_unique<Shard>());
+        shards.back()->slots.resize(sets * WAYS);
+        shards.back()->next.assign(sets, 0);
+    }
+}
+
+uint64_t PlacementCache::key(const Board& b, TetrominoType t) {
+    return b.hash() ^ (0x9E3779B97F4A7C15ull * (uint64_t(t) + 1));
+}
+
+void PlacementCache::canonicalPlacements(const Board& b, const Tetromino& tet, PlacementBuffer& out, EnumerationStats* stats,
+                                         Stats* lookups) {
+    uint64_t k = key(b, tet.type);
+    Shard& shard = *shards[(k >> 32) % shards.size()];
+    size_t set = (uint32_t)k % sets;
+    Slot* ways = &shard.slots[set * WAYS];
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        for(int w=0; w<WAYS; ++w){
+            const Slot& slot = ways[w];
+            if(!slot.used || slot.key != k || slot.type != tet.type || slot.rows != b.rows()) continue;
+            ++shard.hits;
+            if(lookups) ++lookups->hits;
+            out.clear();
+            for(int i=0; i<slot.count; ++i){
+                const Packed& p = slot.placements[i];
+                out.push({p.rotation, p.x, p.y, p.clearedLines, p.aggregateHeight, p.holes, p.bumpiness});
+            }
+            return;
+        }
+        ++shard.misses;
+    }
+    if(lookups) ++lookups->misses;
+
+    b.canonicalPlacements(tet, out, stats);
+
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    for(int w=0; w<WAYS; ++w) if(ways[w].used && ways[w].key == k && ways[w].type == tet.type && ways[w].rows == b.rows()) return;
+    Slot& slot = ways[shard.next[set]];
+    shard.next[set] = (shard.next[set] + 1) % WAYS;
+    slot.key = k;
+    slot.used = true;
+    slot.type = tet.type;
+    slot.rows = b.rows();
+    slot.count = (uint8_t)out.size();
+    for(int i=0; i<out.size(); ++i)
+        slot.placements[i] = {out.rotation[i], out.x[i], out.y[i], out.clearedLines[i], out.aggregateHeight[i], out.holes[i], out.bumpiness[i]};
+}
+
+PlacementCache::Stats PlacementCache::stats() const {
+    Stats s;
+    for(const auto& shard : shards){
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        s.hits += shard->hits;
+        s.misses += shard->misses;
+    }
+    return s;
+}
+
+void PlacementCache::resetStats() {
+    for(auto& shard : shards){
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        shard->hits = shard->misses = 0;
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "Board.h"
+
+// Bounded, sharded cache of Board::canonicalPlacements results keyed by (board hash, piece).
+// Entries keep the full board rows, so a hash collision is a miss, never a wrong answer.
+// Safe to share between threads; each shard has its own lock. A shard is a WAYS-way
+// set-associative table of fixed-size slots allocated up front, so neither a hit nor a miss
+// allocates; a full set overwrites its oldest slot.
+class PlacementCache {
+public:
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        double hitRate() const { return hits + misses ? double(hits) / double(hits + misses) : 0.0; }
+    };
+
+    static constexpr int WAYS = 4;
+
+    explicit PlacementCache(size_t capacity = 1 << 15, int shards = 64);
+
+    // `stats` only sees the misses, which are the lists actually enumerated. `lookups`, if given,
+    // counts this call's hit or miss for the caller, on top of the cache-wide stats().
+    void canonicalPlacements(const Board& b, const Tetromino& tet, PlacementBuffer& out, EnumerationStats* stats = nullptr,
+                             Stats* lookups = nullptr);
+    Stats stats() const;
+    void resetStats();
+
+private:
+    // Placement in 10 bytes; every field fits its PlacementBuffer column type.
+    struct Packed {
+        int8_t rotation, x, y, clearedLines;
+        int16_t aggregateHeight, holes, bumpiness;
+    };
+    struct Slot {
+        uint64_t key = 0;
+        bool used = false;
+        TetrominoType type;
+        uint8_t count = 0;
+        std::array<Board::Row, Board::HEIGHT> rows;
+        std::array<Packed, PlacementBuffer::CAPACITY> placements;
+    };
+    struct Shard {
+        std::mutex mutex;
+        std::vector<Slot> slots;   // sets * WAYS, set s at [s * WAYS, (s + 1) * WAYS)
+        std::vector<uint8_t> next; // per set: the way to overwrite next
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+    };
+    size_t sets; // per shard
+    std::vector<std::unique_ptr<Shard>> shards;
+
+    static uint64_t key(const Board& b, TetrominoType t);
+};
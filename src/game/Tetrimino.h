@@ -1,18 +1,92 @@
 #pragma once
 #include <array>
-#include <vector>
-#include <SFML/Graphics.hpp>
+#include <cstdint>
 
 enum class TetrominoType { I, O, T, L, J, S, Z };
 
+// Geometry of one rotation state inside the 4x4 piece box, precomputed for the board engine.
+struct PieceState {
+    std::array<uint16_t,4> rows;   // bit bx of rows[by] set when cell (bx,by) is filled
+    std::array<uint16_t,4> cols;   // bit by of cols[bx] set when cell (bx,by) is filled
+    std::array<int,4> bottom;      // lowest filled row of each column, -1 for empty columns
+    int minX, maxX;                // filled column span
+};
+
+struct PieceDef {
+    std::array<PieceState,4> states;
+    int numStates;
+};
+
+namespace pieces {
+    // 16-character picture of the 4x4 box, row by row, 'X' for a filled cell.
+    constexpr uint16_t shape(const char (&cells)[17]) {
+        uint16_t s = 0;
+        for (int i = 0; i < 16; ++i) if (cells[i] == 'X') s |= uint16_t(1u << i);
+        return s;
+    }
+
+    // Clockwise rotation inside the top-left n x n corner of the box.
+    constexpr uint16_t rotate(uint16_t s, int n) {
+        uint16_t out = 0;
+        for (int by = 0; by < n; ++by)
+            for (int bx = 0; bx < n; ++bx)
+                if ((s >> (by*4 + bx)) & 1u) out |= uint16_t(1u << (bx*4 + (n - 1 - by)));
+        return out;
+    }
+
+    constexpr PieceState makeState(uint16_t s) {
+        PieceState st{};
+        st.minX = 4; st.maxX = -1;
+        for (int bx = 0; bx < 4; ++bx) st.bottom[bx] = -1;
+        for (int by = 0; by < 4; ++by) {
+            for (int bx = 0; bx < 4; ++bx) {
+                if (!((s >> (by*4 + bx)) & 1u)) continue;
+                st.rows[by] |= uint16_t(1u << bx);
+                st.cols[bx] |= uint16_t(1u << by);
+                st.bottom[bx] = by;
+                if (bx < st.minX) st.minX = bx;
+                if (bx > st.maxX) st.maxX = bx;
+            }
+        }
+        return st;
+    }
+
+    // Spawn state plus its clockwise rotations; unused trailing states repeat the distinct ones.
+    constexpr PieceDef makePiece(uint16_t spawn, int box, int numStates) {
+        PieceDef def{};
+        def.numStates = numStates;
+        uint16_t s = spawn;
+        for (int r = 0; r < 4; ++r) {
+            def.states[r] = r < numStates ? makeState(s) : def.states[r % numStates];
+            s = rotate(s, box);
+        }
+        return def;
+    }
+
+    // Indexed by TetrominoType.
+    inline constexpr std::array<PieceDef,7> TABLE = {
+        makePiece(shape("....XXXX........"), 4, 2), // I
+        makePiece(shape(".XX..XX........."), 4, 1), // O
+        makePiece(shape(".X..XXX........."), 3, 4), // T
+        makePiece(shape("..X.XXX........."), 3, 4), // L
+        makePiece(shape("X...XXX........."), 3, 4), // J
+        makePiece(shape(".XX.XX.........."), 3, 2), // S
+        makePiece(shape("XX...XX........."), 3, 2), // Z
+    };
+}
+
 struct Tetromino {
     TetrominoType type;
-    std::array<std::array<int,16>,4> states;
     int numStates;
-    sf::Color color;
 
     Tetromino() = default;
-    Tetromino(TetrominoType t);
-    const int* state(int rotation) const;
+    constexpr Tetromino(TetrominoType t): type(t), numStates(pieces::TABLE[int(t)].numStates) {}
+    constexpr const PieceState& state(int rotation) const { return pieces::TABLE[int(type)].states[rotation % numStates]; }
+    constexpr bool cell(int rotation, int bx, int by) const { return (state(rotation).rows[by] >> bx) & 1u; }
     int size() const { return 4; }
-};
\ No newline at end of file
+    constexpr const uint16_t* rows(int rotation) const { return state(rotation).rows.data(); }
+    constexpr const uint16_t* cols(int rotation) const { return state(rotation).cols.data(); }
+    constexpr int left(int rotation) const { return state(rotation).minX; }
+    constexpr int right(int rotation) const { return state(rotation).maxX; }
+    constexpr const int* bottom(int rotation) const { return state(rotation).bottom.data(); }
+};
@@ -0,0 +1,86 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include "game/Bag.h"
+#include "game/Board.h"
+#include "neat/NEAT.h"
+
+// Plays a seed corpus with the double-precision network choosing every move and, at each move,
+// records whether the float32 and int8 networks would have picked a different placement. Each
+// mode also plays the corpus on its own so the disagreement rate can be read against lines/game.
+//
+// usage: inference_report [genome file = saved_genome.txt] [seeds = 50]
+
+const neat::Precision MODES[] = {neat::Precision::Double, neat::Precision::Float, neat::Precision::Int8};
+const int NUM_MODES = 3;
+const int MAX_PIECES = 500;
+const int GARBAGE_FREQUENCY = 25;
+
+struct ModeStats {
+    long decisions = 0;
+    long disagreements = 0;
+    long lines = 0;
+};
+
+int playGame(const neat::Phenotype &net, int seed, PlacementBuffer &placements, neat::Activations &act,
+             const neat::Phenotype *others = nullptr, ModeStats *stats = nullptr){
+    Board b;
+    Bag bag(seed);
+    GarbageHoles holes(seed);
+    int totalLines = 0;
+    for(int pieceCount = 1; pieceCount <= MAX_PIECES; ++pieceCount){
+        Tetromino tet(bag.next());
+        b.canonicalPlacements(tet, placements);
+        if(placements.empty()) break;
+        auto cols = placements.featureColumns();
+        int bestIdx = net.argmax(cols.data(), PlacementBuffer::NUM_FEATURES, placements.size(), act);
+        if(bestIdx < 0) break;
+        for(int m = 0; others && m < NUM_MODES; ++m){
+            int idx = others[m].argmax(cols.data(), PlacementBuffer::NUM_FEATURES, placements.size(), act);
+            stats[m].decisions++;
+            if(idx != bestIdx) stats[m].disagreements++;
+        }
+        b.applyPlacement(placements[bestIdx], tet);
+        totalLines += placements.clearedLines[bestIdx];
+        if(pieceCount % GARBAGE_FREQUENCY == 0) b.addGarbageLine(holes.next(Board::WIDTH));
+        if(b.isGameOver()) break;
+    }
+    return totalLines;
+}
+
+int main(int argc, char **argv){
+    std::string genomeFile = argc > 1 ? argv[1] : "saved_genome.txt";
+    int seeds = argc > 2 ? std::stoi(argv[2]) : 50;
+
+    std::ifstream in(genomeFile);
+    if(!in.is_open()){ std::cerr << genomeFile << " not found.\n"; return 1; }
+    neat::Genome g;
+    g.deserialize(in);
+
+    std::vector<neat::Phenotype> nets;
+    for(auto mode : MODES) nets.emplace_back(g, mode);
+    PlacementBuffer placements;
+    neat::Activations act;
+    ModeStats stats[NUM_MODES];
+
+    for(int seed = 0; seed < seeds; ++seed){
+        playGame(nets[0], seed, placements, act, nets.data(), stats);
+        for(int m = 0; m < NUM_MODES; ++m) stats[m].lines += playGame(nets[m], seed, placements, act);
+    }
+
+    std::cout << "Inference precision report: " << genomeFile << ", " << seeds << " seeds, "
+              << g.conns.size() << " connections\n";
+    std::cout << std::left << std::setw(10) << "mode" << std::right << std::setw(12) << "decisions"
+              << std::setw(12) << "differ" << std::setw(10) << "rate" << std::setw(14) << "lines/game" << "\n";
+    for(int m = 0; m < NUM_MODES; ++m){
+        double rate = stats[m].decisions ? 100.0 * stats[m].disagreements / stats[m].decisions : 0.0;
+        std::cout << std::left << std::setw(10) << neat::precisionName(MODES[m]) << std::right
+                  << std::setw(12) << stats[m].decisions << std::setw(12) << stats[m].disagreements
+                  << std::setw(9) << std::fixed << std::setprecision(2) << rate << "%"
+                  << std::setw(14) << std::setprecision(1) << double(stats[m].lines) / seeds << "\n";
+    }
+    return 0;
+}
@@ -0,0 +1,419 @@
+#pragma once
+// Binary population checkpoints.
+//
+// Layout (native little-endian, every section 8-byte aligned):
+//   CheckpointHeader                       64 bytes
+//   uint64_t offsets[genomeCount]          file offset of each genome record
+//   per genome: GenomeRecord, NodeRecord[nodeCount], ConnRecord[connCount]
+// The checksum covers every byte after the header. Weights and fitness are stored as their exact
+// double bits. Files are read in place through a memory mapping and written to "<path>.tmp"
+// first, then renamed over the old checkpoint, so a crash never leaves a torn file behind.
+#include "NEAT.h"
+#include <cstdio>
+#include <string>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace neat
+{
+
+    struct CheckpointHeader
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t byteOrder; // 0x01020304 as written by the saving host
+        uint32_t headerBytes;
+        uint32_t genomeCount;
+        int32_t globalInnov;
+        int32_t nextNodeId;
+        uint64_t fileBytes;
+        uint64_t checksum;
+        uint8_t reserved[16];
+    };
+
+    struct GenomeRecord
+    {
+        uint32_t nodeCount;
+        uint32_t connCount;
+        double fitness;
+    };
+
+    struct NodeRecord
+    {
+        int32_t id;
+        int32_t type;
+    };
+
+    struct ConnRecord
+    {
+        int32_t in, out;
+        int32_t innov;
+        uint32_t enabled;
+        double weight;
+    };
+
+    static_assert(sizeof(CheckpointHeader) == 64, "checkpoint header layout");
+    static_assert(sizeof(GenomeRecord) == 16 && sizeof(NodeRecord) == 8 && sizeof(ConnRecord) == 24,
+                  "checkpoint record layout");
+
+    constexpr char CHECKPOINT_MAGIC[8] = {'N', 'E', 'A', 'T', 'C', 'K', 'P', 'T'};
+    constexpr uint32_t CHECKPOINT_VERSION = 1;
+    constexpr uint32_t CHECKPOINT_BYTE_ORDER = 0x01020304;
+
+    inline uint64_t checkpointChecksum(const unsigned char *data, size_t bytes)
+    {
+        uint64_t h = 0xCBF29CE484222325ull ^ bytes;
+        size_t i = 0;
+        for (; i + 8 <= bytes; i += 8)
+        {
+            uint64_t word;
+            std::memcpy(&word, data + i, 8);
+            h = (h ^ word) * 0x9E3779B97F4A7C15ull;
+            h ^= h >> 29;
+        }
+        for (; i < bytes; ++i)
+            h = (h ^ data[i]) * 0x100000001B3ull;
+        return h;
+    }
+
+    // Read-only mapping of a whole file.
+    class MappedFile
+    {
+    public:
+        MappedFile() = default;
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+        ~MappedFile() { close(); }
+
+        bool open(const std::string &path)
+        {
+            close();
+#ifdef _WIN32
+            file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                               FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+            if (file == INVALID_HANDLE_VALUE)
+                return false;
+            LARGE_INTEGER size;
+            if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+                return close(), false;
+            mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (!mapping)
+                return close(), false;
+            bytes = (size_t)size.QuadPart;
+            base = (const unsigned char *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+            fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0)
+                return false;
+            struct stat st;
+            if (fstat(fd, &st) != 0 || st.st_size == 0)
+                return close(), false;
+            bytes = (size_t)st.st_size;
+            void *p = mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+            base = p == MAP_FAILED ? nullptr : (const unsigned char *)p;
+#endif
+            if (!base)
+                return close(), false;
+            return true;
+        }
+
+        void close()
+        {
+#ifdef _WIN32
+            if (base)
+                UnmapViewOfFile(base);
+            if (mapping)
+                CloseHandle(mapping);
+            if (file != INVALID_HANDLE_VALUE)
+                CloseHandle(file);
+            mapping = nullptr;
+            file = INVALID_HANDLE_VALUE;
+#else
+            if (base)
+                munmap((void *)base, bytes);
+            if (fd >= 0)
+                ::close(fd);
+            fd = -1;
+#endif
+            base = nullptr;
+            bytes = 0;
+        }
+
+        const unsigned char *data() const { return base; }
+        size_t size() const { return bytes; }
+
+    private:
+        const unsigned char *base = nullptr;
+        size_t bytes = 0;
+#ifdef _WIN32
+        HANDLE file = INVALID_HANDLE_VALUE;
+        HANDLE mapping = nullptr;
+#else
+        int fd = -1;
+#endif
+    };
+
+    // Validated, zero-copy view of a checkpoint: genes are read straight from the mapping.
+    class CheckpointView
+    {
+    public:
+        bool open(const std::string &path, std::string *error = nullptr)
+        {
+            auto fail = [&](const char *why)
+            {
+                if (error)
+                    *error = path + ": " + why;
+                file.close();
+                return false;
+            };
+            if (!file.open(path))
+                return fail("cannot open");
+            const unsigned char *p = file.data();
+            size_t n = file.size();
+            if (n < sizeof(CheckpointHeader))
+                return fail("truncated header");
+            std::memcpy(&head, p, sizeof head);
+            if (std::memcmp(head.magic, CHECKPOINT_MAGIC, sizeof head.magic) != 0)
+                return fail("not a population checkpoint");
+            if (head.version != CHECKPOINT_VERSION)
+                return fail("unsupported checkpoint version");
+            if (head.byteOrder != CHECKPOINT_BYTE_ORDER)
+                return fail("checkpoint written with a different byte order");
+            if (head.headerBytes != sizeof(CheckpointHeader) || head.fileBytes != n ||
+                (n - sizeof head) / sizeof(uint64_t) < head.genomeCount)
+                return fail("truncated or resized");
+            if (checkpointChecksum(p + sizeof head, n - sizeof head) != head.checksum)
+                return fail("checksum mismatch");
+            for (int i = 0; i < size(); ++i)
+            {
+                uint64_t at = offset(i);
+                if (at % 8 || at < sizeof head || at + sizeof(GenomeRecord) > n)
+                    return fail("bad genome offset");
+                const GenomeRecord &r = record(i);
+                if (at + sizeof r + (uint64_t)r.nodeCount * sizeof(NodeRecord) + (uint64_t)r.connCount * sizeof(ConnRecord) > n)
+                    return fail("genome runs past the end of the file");
+            }
+            return true;
+        }
+
+        int size() const { return (int)head.genomeCount; }
+        const CheckpointHeader &header() const { return head; }
+
+        const GenomeRecord &record(int i) const { return *(const GenomeRecord *)(file.data() + offset(i)); }
+        const NodeRecord *nodes(int i) const { return (const NodeRecord *)(&record(i) + 1); }
+        const ConnRecord *conns(int i) const { return (const ConnRecord *)(nodes(i) + record(i).nodeCount); }
+
+        // Copies genome i out of the mapping into storage from `resource`.
+        Genome genome(int i, std::pmr::memory_resource *resource = std::pmr::get_default_resource()) const
+        {
+            Genome g(resource);
+            fill(i, g);
+            return g;
+        }
+
+        void fill(int i, Genome &g) const
+        {
+            const GenomeRecord &r = record(i);
+            g.fitness = r.fitness;
+            g.nodes.resize(r.nodeCount);
+            g.conns.resize(r.connCount);
+            const NodeRecord *nr = nodes(i);
+            for (uint32_t k = 0; k < r.nodeCount; ++k)
+                g.nodes[k] = {nr[k].id, nr[k].type};
+            const ConnRecord *cr = conns(i);
+            for (uint32_t k = 0; k < r.connCount; ++k)
+                g.conns[k] = {cr[k].in, cr[k].out, cr[k].weight, cr[k].enabled != 0, cr[k].innov};
+        }
+
+    private:
+        uint64_t offset(int i) const
+        {
+            uint64_t at;
+            std::memcpy(&at, file.data() + sizeof(CheckpointHeader) + (size_t)i * sizeof at, sizeof at);
+            return at;
+        }
+
+        MappedFile file;
+        CheckpointHeader head{};
+    };
+
+    // Encodes `pop` as a checkpoint image. This is the snapshot: the population can change as soon
+    // as it returns.
+    inline std::string encodeCheckpoint(const Population &pop)
+    {
+        size_t bytes = sizeof(CheckpointHeader) + pop.genomes.size() * sizeof(uint64_t);
+        for (const auto &g : pop.genomes)
+            bytes += sizeof(GenomeRecord) + g.nodes.size() * sizeof(NodeRecord) + g.conns.size() * sizeof(ConnRecord);
+        std::string image(bytes, '\0');
+        char *base = &image[0];
+        auto put = [&](size_t at, const void *field, size_t size)
+        {
+            std::memcpy(base + at, field, size);
+            return at + size;
+        };
+
+        CheckpointHeader head{};
+        std::memcpy(head.magic, CHECKPOINT_MAGIC, sizeof head.magic);
+        head.version = CHECKPOINT_VERSION;
+        head.byteOrder = CHECKPOINT_BYTE_ORDER;
+        head.headerBytes = sizeof head;
+        head.genomeCount = (uint32_t)pop.genomes.size();
+        head.globalInnov = pop.globalInnov;
+        head.nextNodeId = pop.nextNodeId;
+        head.fileBytes = bytes;
+
+        size_t at = sizeof head + pop.genomes.size() * sizeof(uint64_t);
+        for (size_t i = 0; i < pop.genomes.size(); ++i)
+        {
+            const Genome &g = pop.genomes[i];
+            uint64_t offset = at;
+            put(sizeof head + i * sizeof offset, &offset, sizeof offset);
+            GenomeRecord r{(uint32_t)g.nodes.size(), (uint32_t)g.conns.size(), g.fitness};
+            at = put(at, &r, sizeof r);
+            for (const auto &n : g.nodes)
+            {
+                NodeRecord nr{n.id, n.type};
+                at = put(at, &nr, sizeof nr);
+            }
+            for (const auto &c : g.conns)
+            {
+                ConnRecord cr{c.in, c.out, c.innov, c.enabled ? 1u : 0u, c.weight};
+                at = put(at, &cr, sizeof cr);
+            }
+        }
+        head.checksum = checkpointChecksum((const unsigned char *)base + sizeof head, bytes - sizeof head);
+        put(0, &head, sizeof head);
+        return image;
+    }
+
+    // One genome in checkpoint record form (GenomeRecord, NodeRecords, ConnRecords), appended to
+    // `out`; this is how genomes travel to remote evaluation workers.
+    inline void appendGenome(const Genome &g, std::string &out)
+    {
+        size_t at = out.size();
+        out.resize(at + sizeof(GenomeRecord) + g.nodes.size() * sizeof(NodeRecord) + g.conns.size() * sizeof(ConnRecord));
+        char *base = &out[0];
+        GenomeRecord r{(uint32_t)g.nodes.size(), (uint32_t)g.conns.size(), g.fitness};
+        std::memcpy(base + at, &r, sizeof r);
+        at += sizeof r;
+        for (const auto &n : g.nodes)
+        {
+            NodeRecord nr{n.id, n.type};
+            std::memcpy(base + at, &nr, sizeof nr);
+            at += sizeof nr;
+        }
+        for (const auto &c : g.conns)
+        {
+            ConnRecord cr{c.in, c.out, c.innov, c.enabled ? 1u : 0u, c.weight};
+            std::memcpy(base + at, &cr, sizeof cr);
+            at += sizeof cr;
+        }
+    }
+
+    // Reads a genome written by appendGenome() at `at`, advancing it. False if the bytes run short.
+    inline bool readGenome(const std::string &in, size_t &at, Genome &g)
+    {
+        GenomeRecord r;
+        if (at + sizeof r > in.size())
+            return false;
+        std::memcpy(&r, in.data() + at, sizeof r);
+        size_t body = (size_t)r.nodeCount * sizeof(NodeRecord) + (size_t)r.connCount * sizeof(ConnRecord);
+        if (in.size() - at - sizeof r < body)
+            return false;
+        at += sizeof r;
+        g.fitness = r.fitness;
+        g.nodes.resize(r.nodeCount);
+        g.conns.resize(r.connCount);
+        for (uint32_t k = 0; k < r.nodeCount; ++k, at += sizeof(NodeRecord))
+        {
+            NodeRecord nr;
+            std::memcpy(&nr, in.data() + at, sizeof nr);
+            g.nodes[k] = {nr.id, nr.type};
+        }
+        for (uint32_t k = 0; k < r.connCount; ++k, at += sizeof(ConnRecord))
+        {
+            ConnRecord cr;
+            std::memcpy(&cr, in.data() + at, sizeof cr);
+            g.conns[k] = {cr.in, cr.out, cr.weight, cr.enabled != 0, cr.innov};
+        }
+        return true;
+    }
+
+    // Replaces `path` with `bytes` via "<path>.tmp" and a rename, so readers see the old or the new
+    // file, never a torn one. Returns false (old file intact) on failure.
+    inline bool writeFileAtomically(const std::string &path, const std::string &bytes, std::string *error = nullptr)
+    {
+        auto fail = [&](const char *why)
+        {
+            if (error)
+                *error = path + ": " + why;
+            return false;
+        };
+        std::string tmp = path + ".tmp";
+        FILE *f = std::fopen(tmp.c_str(), "wb");
+        if (!f)
+            return fail("cannot create temporary file");
+        bool ok = std::fwrite(bytes.data(), 1, bytes.size(), f) == bytes.size() && std::fflush(f) == 0;
+#ifdef _WIN32
+        ok = ok && _commit(_fileno(f)) == 0;
+#else
+        ok = ok && fsync(fileno(f)) == 0;
+#endif
+        ok = std::fclose(f) == 0 && ok;
+        if (!ok)
+        {
+            std::remove(tmp.c_str());
+            return fail("write failed");
+        }
+#ifdef _WIN32
+        if (!MoveFileExA(tmp.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+#else
+        if (std::rename(tmp.c_str(), path.c_str()) != 0)
+#endif
+        {
+            std::remove(tmp.c_str());
+            return fail("cannot replace file");
+        }
+        return true;
+    }
+
+    inline bool saveCheckpoint(const Population &pop, const std::string &path, std::string *error = nullptr)
+    {
+        return writeFileAtomically(path, encodeCheckpoint(pop), error);
+    }
+
+    // Loads a checkpoint into `pop`; all genes land in one arena block sized from the file. Only
+    // what a checkpoint stores is replaced (genomes, globalInnov, nextNodeId): parallelFor, the
+    // rates, rng and species state stay as the caller set them. `pop` is untouched on failure.
+    inline bool loadCheckpoint(const std::string &path, Population &pop, std::string *error = nullptr)
+    {
+        CheckpointView view;
+        if (!view.open(path, error))
+            return false;
+        pop.globalInnov = view.header().globalInnov;
+        pop.nextNodeId = view.header().nextNodeId;
+        pop.genomes.clear(); // nothing may point into the front arena once it is recycled
+        std::pmr::memory_resource *arena = pop.recycleArena(pop.front, view.header().fileBytes + 64 * (size_t)view.size());
+        pop.genomes.reserve(view.size());
+        for (int i = 0; i < view.size(); ++i)
+        {
+            pop.genomes.emplace_back(arena);
+            view.fill(i, pop.genomes.back());
+        }
+        return true;
+    }
+}
@@ -0,0 +1,128 @@
+#pragma once
+// Background checkpointing: files are encoded on the caller's thread (cheap, and the snapshot is
+// then immutable) and written, flushed and renamed into place on a dedicated writer thread, so
+// disk latency overlaps the next generation instead of stalling it.
+#include "Checkpoint.h"
+#include "util/Profile.h"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace neat
+{
+
+    class CheckpointWriter
+    {
+    public:
+        // At most `maxPending` files wait in the queue; further writes block until one is done.
+        explicit CheckpointWriter(size_t maxPending = 2)
+            : maxPending(std::max<size_t>(1, maxPending)), worker([this] { run(); }) {}
+
+        CheckpointWriter(const CheckpointWriter &) = delete;
+        CheckpointWriter &operator=(const CheckpointWriter &) = delete;
+
+        // Finishes every queued write before returning.
+        ~CheckpointWriter()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            wake.notify_all();
+            worker.join();
+        }
+
+        // Queues `bytes` to replace `path` atomically.
+        void write(std::string path, std::string bytes)
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (queue.size() >= maxPending)
+            {
+                ++waits;
+                room.wait(lock, [this]
+                          { return queue.size() < maxPending; });
+            }
+            queue.push_back({std::move(path), std::move(bytes)});
+            wake.notify_one();
+        }
+
+        void checkpoint(const Population &pop, const std::string &path) { write(path, encodeCheckpoint(pop)); }
+
+        // Blocks until everything queued so far is on disk.
+        void flush()
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            room.wait(lock, [this]
+                      { return queue.empty() && !busy; });
+        }
+
+        // Returns and clears the last write error ("" if none).
+        std::string takeError()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            std::string e;
+            e.swap(error);
+            return e;
+        }
+
+        size_t filesWritten() const
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            return written;
+        }
+
+        // How many writes had to wait for a free queue slot.
+        size_t backpressureWaits() const
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            return waits;
+        }
+
+    private:
+        struct Job
+        {
+            std::string path;
+            std::string bytes;
+        };
+
+        void run()
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            for (;;)
+            {
+                wake.wait(lock, [this]
+                          { return stopping || !queue.empty(); });
+                if (queue.empty())
+                    return; // stopping and drained
+                Job job = std::move(queue.front());
+                queue.pop_front();
+                busy = true;
+                room.notify_all();
+                lock.unlock();
+                std::string why;
+                bool ok;
+                {
+                    PROFILE_SCOPE("checkpoint write");
+                    ok = writeFileAtomically(job.path, job.bytes, &why);
+                }
+                lock.lock();
+                busy = false;
+                if (ok)
+                    ++written;
+                else
+                    error = why;
+                room.notify_all();
+            }
+        }
+
+        const size_t maxPending;
+        mutable std::mutex mutex;
+        std::condition_variable wake, room;
+        std::deque<Job> queue;
+        bool busy = false, stopping = false;
+        size_t written = 0, waits = 0;
+        std::string error;
+        std::thread worker; // last: starts after everything it touches is constructed
+    };
+}
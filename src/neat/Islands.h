@@ -0,0 +1,47 @@
+#pragma once
+// Island model support: several Populations evolve side by side and trade champions now and then.
+#include "NEAT.h"
+#include <atomic>
+
+namespace neat
+{
+
+    // Ids per island. Island k numbers new innovations and nodes from k * ISLAND_ID_SPACE, so
+    // structure invented on different islands never shares an id, even after migrants mix.
+    constexpr int ISLAND_ID_SPACE = 1 << 24;
+
+    // Moves the population's innovation and node counters into island `island`'s range (no-op
+    // for island 0, and for a resumed island already inside its range).
+    inline void claimIdSpace(Population &pop, int island)
+    {
+        int base = island * ISLAND_ID_SPACE;
+        pop.globalInnov = std::max(pop.globalInnov, base + 1);
+        pop.nextNodeId = std::max(pop.nextNodeId, base + 1000);
+    }
+
+    // Single-slot exchange between two islands' threads. post() swaps a heap batch in, take()
+    // swaps it out; neither blocks. A batch not taken before the next post() is dropped, so a
+    // slow island always receives the sender's latest champions.
+    class MigrantMailbox
+    {
+    public:
+        MigrantMailbox() = default;
+        MigrantMailbox(const MigrantMailbox &) = delete;
+        MigrantMailbox &operator=(const MigrantMailbox &) = delete;
+        ~MigrantMailbox() { delete slot.load(); }
+
+        // Copies land on the heap, so the batch outlives the sender's generation arenas.
+        void post(std::vector<Genome> migrants)
+        {
+            delete slot.exchange(new std::vector<Genome>(std::move(migrants)), std::memory_order_acq_rel);
+        }
+
+        std::unique_ptr<std::vector<Genome>> take()
+        {
+            return std::unique_ptr<std::vector<Genome>>(slot.exchange(nullptr, std::memory_order_acq_rel));
+        }
+
+    private:
+        std::atomic<std::vector<Genome> *> slot{nullptr};
+    };
+}
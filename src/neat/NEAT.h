@@ -3,7 +3,14 @@
 #include <map>
 #include <random>
 #include <algorithm>
+#include <functional>
 #include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <climits>
+#include <limits>
+#include <memory>
+#include <memory_resource>
 #include <iostream>
 #include <sstream>
 #include <fstream>
@@ -13,6 +20,28 @@ namespace neat
 
     using rng_t = std::mt19937;
 
+    // Counter-based generator: draw i of a stream is a pure function of (stream key, i), so a
+    // child's random choices do not depend on which thread breeds it or in what order.
+    struct StreamRng
+    {
+        using result_type = uint32_t;
+        uint64_t key = 0, counter = 0;
+
+        StreamRng() = default;
+        StreamRng(uint64_t seed, uint64_t stream) : key(mix(seed ^ mix(stream + 0x9E3779B97F4A7C15ull))) {}
+
+        static constexpr result_type min() { return 0; }
+        static constexpr result_type max() { return 0xFFFFFFFFu; }
+        result_type operator()() { return (result_type)(mix(key + ++counter * 0x9E3779B97F4A7C15ull) >> 32); }
+
+        static uint64_t mix(uint64_t z)
+        {
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            return z ^ (z >> 31);
+        }
+    };
+
     inline double sigmoid(double x) { return 1.0 / (1.0 + std::exp(-4.9 * x)); }
 
     struct NodeGene
@@ -31,10 +60,17 @@ namespace neat
 
     struct Genome
     {
-        std::vector<NodeGene> nodes;
-        std::vector<ConnGene> conns;
+        // Gene storage comes from a memory resource: the heap by default, a generation arena inside
+        // Population. Copies made with the copy constructor always land on the heap; assigning into
+        // an arena-backed genome keeps its arena.
+        std::pmr::vector<NodeGene> nodes;
+        std::pmr::vector<ConnGene> conns;
         double fitness = 0.0;
 
+        Genome() = default;
+        explicit Genome(std::pmr::memory_resource *resource) : nodes(resource), conns(resource) {}
+
+        // Reference interpreter. Hot loops should compile a Phenotype once and evaluate that.
         double evaluate(const std::vector<double> &inputs) const
         {
             std::map<int, double> value;
@@ -86,7 +122,8 @@ namespace neat
             return best;
         }
 
-        void mutateWeights(rng_t &rng, double perturbProb = 0.9, double step = 0.5)
+        template <class Rng>
+        void mutateWeights(Rng &rng, double perturbProb = 0.9, double step = 0.5)
         {
             std::uniform_real_distribution<double> unif(0, 1);
             std::normal_distribution<double> norm(0, step);
@@ -103,104 +140,212 @@ namespace neat
             }
         }
 
-        void addConnection(rng_t &rng, int &globalInnov)
+        // Structural mutations come in two halves so the random choice can run on any thread while
+        // innovation numbers are handed out in a fixed order afterwards (see Population::epoch).
+
+        // Picks a new link between two unconnected nodes; its innov is left for the caller to assign.
+        template <class Rng>
+        bool proposeConnection(Rng &rng, ConnGene &link) const
         {
             if (nodes.size() < 2)
-                return;
+                return false;
             std::uniform_int_distribution<int> pick(0, nodes.size() - 1);
             int a = pick(rng), b = pick(rng);
-            int in = nodes[a].id, out = nodes[b].id;
             if (nodes[a].type > nodes[b].type)
-            {
                 std::swap(a, b);
-                in = nodes[a].id;
-                out = nodes[b].id;
-            }
+            int in = nodes[a].id, out = nodes[b].id;
             if (nodes[a].type == 2 || nodes[b].type == 0 || nodes[b].type == 3)
-                return;
+                return false;
             for (auto &c : conns)
                 if (c.in == in && c.out == out)
-                    return;
-            ConnGene cg;
-            cg.in = in;
-            cg.out = out;
-            cg.weight = std::uniform_real_distribution<double>(-1, 1)(rng);
-            cg.enabled = true;
-            cg.innov = globalInnov++;
-            conns.push_back(cg);
+                    return false;
+            link.in = in;
+            link.out = out;
+            link.weight = std::uniform_real_distribution<double>(-1, 1)(rng);
+            link.enabled = true;
+            link.innov = 0;
+            return true;
         }
 
-        void addNode(rng_t &rng, int &globalInnov, int &nextNodeId)
+        // Disables a random enabled connection to be split by a new node; returns its index or -1.
+        template <class Rng>
+        int proposeSplit(Rng &rng)
         {
             if (conns.empty())
-                return;
+                return -1;
             std::uniform_int_distribution<int> pick(0, conns.size() - 1);
             int idx = pick(rng);
             if (!conns[idx].enabled)
-                return;
+                return -1;
             conns[idx].enabled = false;
-            NodeGene ng;
-            ng.id = nextNodeId++;
-            ng.type = 1;
+            return idx;
+        }
+
+        // Inserts a gene at its sorted position (innovation numbers may be reused within a generation).
+        void insertNode(const NodeGene &n)
+        {
+            nodes.insert(std::upper_bound(nodes.begin(), nodes.end(), n.id, [](int id, const NodeGene &g)
+                                          { return id < g.id; }),
+                         n);
+        }
+
+        void insertConn(const ConnGene &c)
+        {
+            conns.insert(std::upper_bound(conns.begin(), conns.end(), c.innov, [](int innov, const ConnGene &g)
+                                          { return innov < g.innov; }),
+                         c);
+        }
+
+        // Immediate versions that number new genes from the running counters.
+        template <class Rng>
+        void addConnection(Rng &rng, int &globalInnov)
+        {
+            ConnGene link;
+            if (!proposeConnection(rng, link))
+                return;
+            link.innov = globalInnov++;
+            conns.push_back(link);
+        }
+
+        template <class Rng>
+        void addNode(Rng &rng, int &globalInnov, int &nextNodeId)
+        {
+            int idx = proposeSplit(rng);
+            if (idx < 0)
+                return;
+            ConnGene split = conns[idx];
+            NodeGene ng{nextNodeId++, 1};
             nodes.push_back(ng);
-            ConnGene c1;
-            c1.in = conns[idx].in;
-            c1.out = ng.id;
-            c1.weight = 1.0;
-            c1.enabled = true;
-            c1.innov = globalInnov++;
-            ConnGene c2;
-            c2.in = ng.id;
-            c2.out = conns[idx].out;
-            c2.weight = conns[idx].weight;
-            c2.enabled = true;
-            c2.innov = globalInnov++;
-            conns.push_back(c1);
-            conns.push_back(c2);
-        }
-
-        static Genome crossover(const Genome &a, const Genome &b, rng_t &rng)
+            conns.push_back({split.in, ng.id, 1.0, true, globalInnov++});
+            conns.push_back({ng.id, split.out, split.weight, true, globalInnov++});
+        }
+
+        // Nodes are kept sorted by id and connections by innovation number (every mutation appends
+        // a fresh, larger number), so both parents can be walked in lockstep: one linear merge per
+        // gene list. Matching genes are picked at random, disjoint and excess genes come from a.
+        template <class Rng>
+        static Genome crossover(const Genome &a, const Genome &b, Rng &rng)
         {
             Genome child;
-            std::map<int, NodeGene> nodeMap;
-            for (auto &n : a.nodes)
-                nodeMap[n.id] = n;
-            for (auto &n : b.nodes)
-                if (nodeMap.find(n.id) == nodeMap.end())
-                    nodeMap[n.id] = n;
-            for (auto &kv : nodeMap)
-                child.nodes.push_back(kv.second);
-
-            std::map<int, const ConnGene *> innovA;
-            for (const auto &c : a.conns)
-                innovA[c.innov] = &c;
-            std::map<int, const ConnGene *> innovB;
-            for (const auto &c : b.conns)
-                innovB[c.innov] = &c;
-
-            for (auto const &[innov, geneA] : innovA)
-            {
-                auto itB = innovB.find(innov);
-                if (itB != innovB.end())
+            crossover(a, b, rng, child);
+            return child;
+        }
+
+        // Capacity a child of a and b needs, including one addNode and one addConnection.
+        static void reserveChild(const Genome &a, const Genome &b, Genome &child)
+        {
+            std::pair<size_t, size_t> capacity = childCapacity(a, b);
+            child.nodes.reserve(capacity.first);
+            child.conns.reserve(capacity.second);
+        }
+
+        // {nodes, conns} reserveChild() reserves.
+        static std::pair<size_t, size_t> childCapacity(const Genome &a, const Genome &b)
+        {
+            return {a.nodes.size() + b.nodes.size() + 1, a.conns.size() + 3};
+        }
+
+        // Writes the child into an existing genome, keeping its memory resource. Does not allocate
+        // when the child already has reserveChild() capacity.
+        template <class Rng>
+        static void crossover(const Genome &a, const Genome &b, Rng &rng, Genome &child)
+        {
+            child.nodes.clear();
+            child.conns.clear();
+            child.fitness = 0.0;
+            reserveChild(a, b, child);
+            auto na = a.nodes.begin(), nb = b.nodes.begin();
+            while (na != a.nodes.end() || nb != b.nodes.end())
+            {
+                if (nb == b.nodes.end() || (na != a.nodes.end() && na->id <= nb->id))
+                {
+                    if (nb != b.nodes.end() && nb->id == na->id)
+                        ++nb;
+                    child.nodes.push_back(*na++);
+                }
+                else
+                    child.nodes.push_back(*nb++);
+            }
+
+            auto cb = b.conns.begin();
+            for (const auto &geneA : a.conns)
+            {
+                while (cb != b.conns.end() && cb->innov < geneA.innov)
+                    ++cb;
+                if (cb != b.conns.end() && cb->innov == geneA.innov)
                 { // Matching gene
-                    child.conns.push_back(std::uniform_real_distribution<>(0, 1)(rng) < 0.5 ? *geneA : *(itB->second));
+                    child.conns.push_back(std::uniform_real_distribution<>(0, 1)(rng) < 0.5 ? geneA : *cb);
                 }
                 else
                 { // Disjoint/Excess from A
-                    child.conns.push_back(*geneA);
+                    child.conns.push_back(geneA);
                 }
             }
-            return child;
+        }
+
+        // NEAT compatibility distance c1*E/N + c2*D/N + c3*W from one merge pass over the sorted
+        // connection genes: E excess and D disjoint genes, W mean weight difference of matching
+        // genes, N the larger genome's gene count (1 for genomes under 20 genes).
+        static double compatibility(const Genome &a, const Genome &b, double c1, double c2, double c3)
+        {
+            auto ia = a.conns.begin(), ib = b.conns.begin();
+            int disjoint = 0, matching = 0;
+            double weightDiff = 0.0;
+            while (ia != a.conns.end() && ib != b.conns.end())
+            {
+                if (ia->innov == ib->innov)
+                {
+                    weightDiff += std::abs(ia->weight - ib->weight);
+                    ++matching;
+                    ++ia;
+                    ++ib;
+                }
+                else if (ia->innov < ib->innov)
+                {
+                    ++disjoint;
+                    ++ia;
+                }
+                else
+                {
+                    ++disjoint;
+                    ++ib;
+                }
+            }
+            int excess = (int)(a.conns.end() - ia) + (int)(b.conns.end() - ib);
+            size_t longest = std::max(a.conns.size(), b.conns.size());
+            double n = longest < 20 ? 1.0 : (double)longest;
+            return c1 * excess / n + c2 * disjoint / n + c3 * (matching ? weightDiff / matching : 0.0);
+        }
+
+        // Hash of every gene (weights by bit pattern); genomes with equal hashes behave identically.
+        uint64_t contentHash() const
+        {
+            uint64_t h = StreamRng::mix(nodes.size() * 0x9E3779B97F4A7C15ull + conns.size());
+            auto add = [&h](uint64_t v)
+            { h = StreamRng::mix(h ^ v) + 0x9E3779B97F4A7C15ull; };
+            for (const auto &n : nodes)
+                add(((uint64_t)(uint32_t)n.id << 32) | (uint32_t)n.type);
+            for (const auto &c : conns)
+            {
+                uint64_t bits;
+                std::memcpy(&bits, &c.weight, sizeof bits);
+                add(((uint64_t)(uint32_t)c.in << 32) | (uint32_t)c.out);
+                add(((uint64_t)(uint32_t)c.innov << 1) | (c.enabled ? 1u : 0u));
+                add(bits);
+            }
+            return h;
         }
 
         void serialize(std::ostream &os) const
         {
+            std::streamsize precision = os.precision(std::numeric_limits<double>::max_digits10); // round-trip exact
             os << nodes.size() << "\n";
             for (auto &n : nodes)
                 os << n.id << " " << n.type << "\n";
             os << conns.size() << "\n";
             for (auto &c : conns)
                 os << c.innov << " " << c.in << " " << c.out << " " << c.weight << " " << c.enabled << "\n";
+            os.precision(precision);
         }
 
         void deserialize(std::istream &is)
@@ -226,6 +371,404 @@ namespace neat
         }
     };
 
+    // Arithmetic used by Phenotype::evaluateBatch/argmax. Double is the reference; Float runs in
+    // float32 with fastSigmoid, Int8 uses int8 weights, Q16 fixed-point activations and an
+    // interpolated sigmoid table. Only the argmax matters for move choice, so the narrower modes
+    // trade exact scores for more lanes per vector register and a smaller weight footprint.
+    enum class Precision
+    {
+        Double,
+        Float,
+        Int8
+    };
+
+    inline const char *precisionName(Precision p)
+    {
+        return p == Precision::Double ? "double" : p == Precision::Float ? "float32" : "int8";
+    }
+
+    // exp(x) from 2^floor(x*log2 e) times a quadratic fit of the fractional power (~0.2% error).
+    inline float fastExp(float x)
+    {
+        float t = std::min(std::max(x * 1.44269504f, -126.0f), 126.0f);
+        float whole = std::floor(t);
+        float f = t - whole;
+        float scale;
+        int32_t bits = (int32_t(whole) + 127) << 23;
+        std::memcpy(&scale, &bits, sizeof(scale));
+        return scale * (1.0f + f * (0.6565f + f * 0.3435f));
+    }
+
+    inline float fastSigmoid(float x) { return 1.0f / (1.0f + fastExp(-4.9f * x)); }
+
+    // Per-thread scratch for Phenotype evaluation, sized on first use and reused afterwards.
+    struct Activations
+    {
+        std::vector<double> d;
+        std::vector<float> f;
+        std::vector<int32_t> q;
+    };
+
+    // A genome compiled for repeated evaluation. Node ids are remapped to dense slots (inputs and
+    // bias first), the enabled connections are packed into contiguous index/weight arrays and the
+    // hidden/output slots to squash are listed once, so evaluate() is a few tight loops with no
+    // map lookups and no allocation.
+    //
+    // Results are bit-identical to Genome::evaluate: three relaxation passes over the connections
+    // in genome order, each followed by a sigmoid on every hidden and output node. Because each
+    // pass adds onto the values left by the previous one, connection order is part of the network's
+    // meaning and recurrent edges are simply read with whatever value their source holds at that
+    // point, so edges keep genome order rather than being re-sorted topologically.
+    struct Phenotype
+    {
+        static constexpr int PASSES = 3;
+        static constexpr int Q_ONE = 1 << 16; // fixed-point 1.0 for Int8 activations
+
+        Precision precision = Precision::Double;
+        std::vector<int> inputSlots; // one per input node, in genome order
+        std::vector<int> biasSlots;
+        std::vector<int> squashSlots; // hidden and output nodes, in genome order
+        std::vector<int> hiddenSlots;
+        std::vector<int> outputSlots;
+        std::vector<int> connIn, connOut;
+        std::vector<double> connWeight;
+        std::vector<float> connWeightF;  // Float only
+        std::vector<int8_t> connWeightQ; // Int8 only: weight ~= q * weightScale / 65536
+        int64_t weightScale = 0;
+        int numSlots = 0;
+
+        Phenotype() = default;
+
+        explicit Phenotype(const Genome &g, Precision p = Precision::Double) : precision(p)
+        {
+            std::vector<std::pair<int, int>> slotOf; // (node id, slot), sorted by id
+            auto slot = [&](int id)
+            {
+                auto it = std::lower_bound(slotOf.begin(), slotOf.end(), std::make_pair(id, -1));
+                return it != slotOf.end() && it->first == id ? it->second : -1;
+            };
+            auto addSlot = [&](int id)
+            {
+                int s = slot(id);
+                if (s >= 0)
+                    return s;
+                slotOf.insert(std::lower_bound(slotOf.begin(), slotOf.end(), std::make_pair(id, -1)), {id, numSlots});
+                return numSlots++;
+            };
+            for (auto &n : g.nodes)
+                if (n.type == 0 || n.type == 3)
+                    addSlot(n.id);
+            for (auto &n : g.nodes)
+                addSlot(n.id);
+            for (auto &c : g.conns)
+            {
+                if (!c.enabled)
+                    continue;
+                connIn.push_back(addSlot(c.in));
+                connOut.push_back(addSlot(c.out));
+                connWeight.push_back(c.weight);
+            }
+            for (auto &n : g.nodes)
+            {
+                if (n.type == 0)
+                    inputSlots.push_back(slot(n.id));
+                if (n.type == 3)
+                    biasSlots.push_back(slot(n.id));
+                if (n.type == 1 || n.type == 2)
+                    squashSlots.push_back(slot(n.id));
+                if (n.type == 1)
+                    hiddenSlots.push_back(slot(n.id));
+                if (n.type == 2)
+                    outputSlots.push_back(slot(n.id));
+            }
+            if (precision == Precision::Float)
+                connWeightF.assign(connWeight.begin(), connWeight.end());
+            if (precision == Precision::Int8)
+            {
+                double maxAbs = 0.0;
+                for (double w : connWeight)
+                    maxAbs = std::max(maxAbs, std::abs(w));
+                double scale = maxAbs > 0.0 ? maxAbs / 127.0 : 1.0;
+                weightScale = std::max<int64_t>(1, std::llround(scale * 65536.0));
+                for (double w : connWeight)
+                    connWeightQ.push_back((int8_t)std::lround(w / scale));
+            }
+        }
+
+        // Scalar reference path; always double regardless of precision. Activations are
+        // caller-owned so one Phenotype can be shared between threads.
+        double evaluate(const double *inputs, int numInputs, Activations &act) const
+        {
+            std::vector<double> &values = act.d;
+            values.assign(numSlots, 0.0);
+            for (int s : biasSlots)
+                values[s] = 1.0;
+            for (int i = 0; i < (int)inputSlots.size(); ++i)
+                values[inputSlots[i]] = i < numInputs ? inputs[i] : 0.0;
+            const int nConns = (int)connWeight.size();
+            for (int pass = 0; pass < PASSES; ++pass)
+            {
+                for (int c = 0; c < nConns; ++c)
+                    values[connOut[c]] = values[connOut[c]] + values[connIn[c]] * connWeight[c];
+                for (int s : squashSlots)
+                    values[s] = sigmoid(values[s]);
+            }
+            double best = -1e9;
+            for (int s : outputSlots)
+                best = std::max(best, values[s]);
+            return best;
+        }
+
+        // Scores `count` candidates at once in the compiled precision. Input i of candidate k is
+        // columns[i][k]; activations hold one contiguous lane per slot, so every connection is a
+        // multiply-add across the whole batch. In Double each lane performs exactly the operations
+        // of evaluate(), so scores match it bit for bit.
+        void evaluateBatch(const double *const *columns, int numInputs, int count, double *out, Activations &act) const
+        {
+            switch (precision)
+            {
+            case Precision::Double:
+                runBatch(columns, numInputs, count, act.d, connWeight, [](double x) { return sigmoid(x); });
+                for (int k = 0; k < count; ++k)
+                    out[k] = batchOutput(act.d, count, k, -1e9);
+                break;
+            case Precision::Float:
+                runBatch(columns, numInputs, count, act.f, connWeightF, [](float x) { return fastSigmoid(x); });
+                for (int k = 0; k < count; ++k)
+                    out[k] = batchOutput(act.f, count, k, -1e9f);
+                break;
+            case Precision::Int8:
+                runQuantized(columns, numInputs, count, act.q);
+                for (int k = 0; k < count; ++k)
+                    out[k] = batchOutput(act.q, count, k, INT32_MIN) / double(Q_ONE);
+                break;
+            }
+        }
+
+        // Index of the first best-scoring candidate, or -1 if there is none (no candidates or no
+        // output nodes), matching a strict `score > best` scan over evaluate(). The narrow modes
+        // rank outputs before their final sigmoid: it is monotonic, so the order is the same and
+        // no resolution is lost to its flat tails.
+        int argmax(const double *const *columns, int numInputs, int count, Activations &act) const
+        {
+            switch (precision)
+            {
+            case Precision::Double:
+                runBatch(columns, numInputs, count, act.d, connWeight, [](double x) { return sigmoid(x); });
+                return batchArgmax(act.d, count, -1e9);
+            case Precision::Float:
+                runBatch(columns, numInputs, count, act.f, connWeightF, [](float x) { return fastSigmoid(x); }, false);
+                return batchArgmax(act.f, count, -std::numeric_limits<float>::max());
+            case Precision::Int8:
+                runQuantized(columns, numInputs, count, act.q, false);
+                return batchArgmax(act.q, count, INT32_MIN);
+            }
+            return -1;
+        }
+
+        // sigmoid(4.9x) on Q16 inputs by linear interpolation in a 1536-step table over [-3, 3);
+        // outside it the curve is within 1e-6 of 0 or 1.
+        static int32_t quantizedSigmoid(int32_t x)
+        {
+            constexpr int SHIFT = 8, STEPS = 6 * Q_ONE >> SHIFT; // 2^SHIFT fixed-point units per step
+            static_assert((STEPS << SHIFT) == 6 * Q_ONE, "the table must cover [-3, 3) in whole steps");
+            static const std::vector<int32_t> table = []
+            {
+                std::vector<int32_t> t(STEPS + 1);
+                for (int i = 0; i <= STEPS; ++i)
+                    t[i] = (int32_t)std::lround(sigmoid(((int64_t)i * 6 * Q_ONE / STEPS - 3 * Q_ONE) / double(Q_ONE)) * Q_ONE);
+                return t;
+            }();
+            int64_t u = std::min<int64_t>(std::max<int64_t>(x, -3 * Q_ONE), 3 * Q_ONE - 1) + 3 * Q_ONE;
+            int64_t i = u >> SHIFT, frac = u & ((1 << SHIFT) - 1);
+            return (int32_t)(table[i] + (((table[i + 1] - table[i]) * frac) >> SHIFT));
+        }
+
+    private:
+        template <typename T>
+        static void axpy(T *__restrict out, const T *__restrict in, T w, int count)
+        {
+            for (int k = 0; k < count; ++k)
+                out[k] = out[k] + in[k] * w;
+        }
+
+        template <typename T>
+        static void selfAxpy(T *v, T w, int count)
+        {
+            for (int k = 0; k < count; ++k)
+                v[k] = v[k] + v[k] * w;
+        }
+
+        template <typename T, typename Squash>
+        void runBatch(const double *const *columns, int numInputs, int count, std::vector<T> &values,
+                      const std::vector<T> &weights, Squash squash, bool squashOutputsLast = true) const
+        {
+            values.assign((size_t)numSlots * count, T(0));
+            auto lane = [&](int s)
+            { return values.data() + (size_t)s * count; };
+            for (int s : biasSlots)
+                std::fill(lane(s), lane(s) + count, T(1));
+            for (int i = 0; i < (int)inputSlots.size(); ++i)
+            {
+                T *v = lane(inputSlots[i]);
+                if (i < numInputs)
+                    std::copy(columns[i], columns[i] + count, v);
+                else
+                    std::fill(v, v + count, T(0));
+            }
+            const int nConns = (int)weights.size();
+            for (int pass = 0; pass < PASSES; ++pass)
+            {
+                for (int c = 0; c < nConns; ++c)
+                {
+                    if (connIn[c] == connOut[c])
+                        selfAxpy(lane(connOut[c]), weights[c], count);
+                    else
+                        axpy(lane(connOut[c]), lane(connIn[c]), weights[c], count);
+                }
+                for (int s : (squashOutputsLast || pass + 1 < PASSES) ? squashSlots : hiddenSlots)
+                {
+                    T *v = lane(s);
+                    for (int k = 0; k < count; ++k)
+                        v[k] = squash(v[k]);
+                }
+            }
+        }
+
+        // Q16 activations in int32 lanes; each connection multiplies in 64 bits and clamps back,
+        // which baseline SSE2 cannot vectorize. So Int8 is no faster than Double on a network
+        // without hidden nodes, and only draws level with Float from about 16 hidden nodes on
+        // (bench --filter precision); what it saves is weight storage, not arithmetic.
+        void runQuantized(const double *const *columns, int numInputs, int count, std::vector<int32_t> &values,
+                          bool squashOutputsLast = true) const
+        {
+            values.assign((size_t)numSlots * count, 0);
+            auto lane = [&](int s)
+            { return values.data() + (size_t)s * count; };
+            for (int s : biasSlots)
+                std::fill(lane(s), lane(s) + count, Q_ONE);
+            for (int i = 0; i < (int)inputSlots.size(); ++i)
+            {
+                int32_t *v = lane(inputSlots[i]);
+                if (i >= numInputs)
+                {
+                    std::fill(v, v + count, 0);
+                    continue;
+                }
+                for (int k = 0; k < count; ++k) // std::lround without the libm call, so it vectorizes
+                {
+                    double x = columns[i][k] * Q_ONE;
+                    v[k] = (int32_t)(x + (x < 0 ? -0.5 : 0.5));
+                }
+            }
+            const int nConns = (int)connWeightQ.size();
+            for (int pass = 0; pass < PASSES; ++pass)
+            {
+                for (int c = 0; c < nConns; ++c)
+                {
+                    int32_t *out = lane(connOut[c]);
+                    const int32_t *in = lane(connIn[c]);
+                    const int64_t m = connWeightQ[c] * weightScale;
+                    for (int k = 0; k < count; ++k)
+                    {
+                        int64_t v = out[k] + ((in[k] * m) >> 16);
+                        out[k] = (int32_t)std::min<int64_t>(std::max<int64_t>(v, INT32_MIN + 1), INT32_MAX);
+                    }
+                }
+                for (int s : (squashOutputsLast || pass + 1 < PASSES) ? squashSlots : hiddenSlots)
+                {
+                    int32_t *v = lane(s);
+                    for (int k = 0; k < count; ++k)
+                        v[k] = quantizedSigmoid(v[k]);
+                }
+            }
+        }
+
+        template <typename T>
+        T batchOutput(const std::vector<T> &values, int count, int k, T floor) const
+        {
+            T best = floor;
+            for (int s : outputSlots)
+                best = std::max(best, values[(size_t)s * count + k]);
+            return best;
+        }
+
+        template <typename T>
+        int batchArgmax(const std::vector<T> &values, int count, T floor) const
+        {
+            T best = floor;
+            int bestIdx = -1;
+            for (int k = 0; k < count; ++k)
+            {
+                T score = batchOutput(values, count, k, floor);
+                if (score > best)
+                {
+                    best = score;
+                    bestIdx = k;
+                }
+            }
+            return bestIdx;
+        }
+    };
+
+    // A niche of structurally similar genomes. Members index into Population::genomes.
+    struct Species
+    {
+        int id = 0;
+        Genome representative;
+        std::vector<int> members;
+        double bestFitness = -1.0;
+        int staleness = 0;      // generations since bestFitness last improved
+        double shared = 0.0;    // sum of member fitness / member count (explicit fitness sharing)
+    };
+
+    // Numbers one generation's structural mutations: children that add the same link, or split
+    // the same link, receive the same innovation numbers (and node id) instead of fresh ones.
+    struct InnovationRegistry
+    {
+        struct Split
+        {
+            int node, inInnov, outInnov;
+        };
+        std::map<std::pair<int, int>, int> links;    // (in, out) -> innovation
+        std::map<std::pair<int, int>, Split> splits; // (in, out) of the split link -> new genes
+
+        void clear()
+        {
+            links.clear();
+            splits.clear();
+        }
+
+        int link(int in, int out, int &globalInnov)
+        {
+            auto it = links.find({in, out});
+            if (it == links.end())
+                it = links.emplace(std::make_pair(in, out), globalInnov++).first;
+            return it->second;
+        }
+
+        Split split(int in, int out, int &globalInnov, int &nextNodeId)
+        {
+            auto it = splits.find({in, out});
+            if (it == splits.end())
+            {
+                Split fresh{nextNodeId++, globalInnov, globalInnov + 1};
+                globalInnov += 2;
+                it = splits.emplace(std::make_pair(in, out), fresh).first;
+            }
+            return it->second;
+        }
+    };
+
+    // Runs body(i) for every i in [0, n), in any order and on any threads.
+    using ParallelFor = std::function<void(int n, const std::function<void(int)> &body)>;
+
+    inline void serialFor(int n, const std::function<void(int)> &body)
+    {
+        for (int i = 0; i < n; ++i)
+            body(i);
+    }
+
     struct Population
     {
         std::vector<Genome> genomes;
@@ -233,7 +776,59 @@ namespace neat
         int globalInnov = 1;
         int nextNodeId = 1000;
 
+        // Speciation. Genomes join the first species whose representative is within compatThreshold;
+        // the threshold drifts by thresholdStep each generation to steer towards targetSpecies.
+        std::vector<Species> species;
+        int nextSpeciesId = 0;
+        double c1 = 1.0, c2 = 1.0, c3 = 0.4;
+        double compatThreshold = 3.0;
+        double thresholdStep = 0.3;
+        int targetSpecies = 8;
+        int staleLimit = 15;          // stale species get no offspring unless they hold a top-2 champion
+        double survivalThreshold = 0.5; // fraction of each species eligible as parents
+        double interspeciesRate = 0.001;
+
+        // Mutation applied to every bred child (elite copies are left alone).
+        double weightPerturbProb = 0.9; // otherwise the weight is redrawn
+        double weightStep = 0.5;        // sigma of a weight perturbation
+        double addNodeRate = 0.05;
+        double addLinkRate = 0.2;
+
+        // Genome storage is double-buffered: the current generation lives in arenas[front] and
+        // epoch() writes children into the other arena. `spare` holds the previous generation's
+        // genomes until that arena is recycled, and keeps its slot capacity for the next children.
+        // Genome vectors are declared before the arenas so member-wise moves release genomes first.
+        // Each arena carves a persistent block (grown when a generation outgrows it) so recycling
+        // an arena reuses warm memory rather than mapping fresh pages.
+        std::vector<Genome> spare;
+        std::unique_ptr<std::max_align_t[]> arenaBlocks[2]; // uninitialised: the arena only hands it out
+        size_t arenaBlockCount[2] = {0, 0};
+        std::unique_ptr<std::pmr::monotonic_buffer_resource> arenas[2];
+        int front = 0;
+
+        // Reproduction. Each child is bred from its own StreamRng stream, so the next generation
+        // is identical whatever parallelFor does; only the serial structural phase touches the
+        // shared innovation and node counters.
+        struct Birth
+        {
+            int parentA = 0, parentB = -1; // indices into genomes; parentB < 0 copies parentA
+            StreamRng rng;
+            int split = -1; // connection disabled for a new node, or -1
+            bool link = false;
+            ConnGene newLink{};
+        };
+        ParallelFor parallelFor = serialFor;
+        InnovationRegistry innovations;
+        std::vector<Birth> births;
+
         Population() = default;
+        Population(Population &&) = default;
+        Population &operator=(Population &&) = default;
+        ~Population()
+        { // members die in reverse order, so release the genomes before their arenas
+            genomes.clear();
+            spare.clear();
+        }
 
         Population(int populationSize, int numInputs, int numOutputs, int seed = 42)
         {
@@ -249,6 +844,7 @@ namespace neat
                 for (int o = 0; o < numOutputs; ++o)
                     g.nodes.push_back({next++, 2});
                 nextNodeId = std::max(nextNodeId, next);
+                int innov = 1; // the same initial link carries the same innovation in every genome
                 for (auto &inN : g.nodes)
                 {
                     if (inN.type == 0 || inN.type == 3)
@@ -261,38 +857,260 @@ namespace neat
                                 c.out = outN.id;
                                 c.weight = std::uniform_real_distribution<double>(-1, 1)(rng);
                                 c.enabled = true;
-                                c.innov = globalInnov++;
+                                c.innov = innov++;
                                 g.conns.push_back(c);
                             }
                     }
                 }
+                globalInnov = std::max(globalInnov, innov);
+            }
+        }
+
+        int numSpecies() const { return (int)species.size(); }
+
+        // Assigns every genome (sorted best first) to a species and updates species bookkeeping.
+        void speciate()
+        {
+            for (auto &sp : species)
+                sp.members.clear();
+            for (int i = 0; i < (int)genomes.size(); ++i)
+            {
+                Species *home = nullptr;
+                for (auto &sp : species)
+                    if (Genome::compatibility(genomes[i], sp.representative, c1, c2, c3) < compatThreshold)
+                    {
+                        home = &sp;
+                        break;
+                    }
+                if (!home)
+                {
+                    species.emplace_back();
+                    home = &species.back();
+                    home->id = nextSpeciesId++;
+                    home->representative = genomes[i];
+                }
+                home->members.push_back(i);
+            }
+            species.erase(std::remove_if(species.begin(), species.end(), [](const Species &sp)
+                                         { return sp.members.empty(); }),
+                          species.end());
+            for (auto &sp : species)
+            {
+                double best = genomes[sp.members[0]].fitness, sum = 0.0;
+                for (int m : sp.members)
+                    sum += genomes[m].fitness;
+                sp.shared = sum / sp.members.size();
+                if (best > sp.bestFitness)
+                {
+                    sp.bestFitness = best;
+                    sp.staleness = 0;
+                }
+                else
+                    ++sp.staleness;
+            }
+            if ((int)species.size() > targetSpecies)
+                compatThreshold += thresholdStep;
+            else if ((int)species.size() < targetSpecies)
+                compatThreshold = std::max(thresholdStep, compatThreshold - thresholdStep);
+        }
+
+        // Splits `total` offspring between species in proportion to their shared fitness, by
+        // largest remainder. Stale species are skipped unless they hold one of the two best champions.
+        std::vector<int> allocateOffspring(int total) const
+        {
+            if (species.empty())
+                return {};
+            std::vector<double> weight(species.size(), 0.0);
+            std::vector<double> champions;
+            for (auto &sp : species)
+                champions.push_back(genomes[sp.members[0]].fitness);
+            std::sort(champions.begin(), champions.end(), std::greater<double>());
+            double cutoff = champions.size() > 1 ? champions[1] : champions.empty() ? 0.0 : champions[0];
+            double sum = 0.0;
+            for (size_t i = 0; i < species.size(); ++i)
+            {
+                const Species &sp = species[i];
+                if (sp.staleness >= staleLimit && genomes[sp.members[0]].fitness < cutoff)
+                    continue;
+                weight[i] = sp.shared;
+                sum += weight[i];
+            }
+            if (sum <= 0.0)
+            { // nothing scored yet: share by size
+                sum = 0.0;
+                for (size_t i = 0; i < species.size(); ++i)
+                    sum += weight[i] = (double)species[i].members.size();
             }
+            std::vector<int> quota(species.size(), 0);
+            std::vector<std::pair<double, int>> remainders;
+            int given = 0;
+            for (size_t i = 0; i < species.size(); ++i)
+            {
+                double exact = total * weight[i] / sum;
+                quota[i] = (int)exact;
+                given += quota[i];
+                remainders.push_back({exact - quota[i], (int)i});
+            }
+            std::sort(remainders.begin(), remainders.end(), [](const std::pair<double, int> &a, const std::pair<double, int> &b)
+                      { return a.first > b.first || (a.first == b.first && a.second < b.second); });
+            for (int r = 0; given < total; r = (r + 1) % (int)remainders.size(), ++given)
+                quota[remainders[r].second]++;
+            return quota;
         }
 
+        // One NEAT generation: speciate, keep the global elites and each sizeable species' champion
+        // that is not one of them, then breed every species' share of the remaining slots from its own best members.
+        // Selection and arena allocation run serially, crossover and mutation through parallelFor,
+        // then structural genes are numbered in child order.
         void epoch(int elites = 2)
         {
             std::sort(genomes.begin(), genomes.end(), [](const Genome &a, const Genome &b)
                       { return a.fitness > b.fitness; });
-            std::vector<Genome> next;
+            speciate();
+            births.clear();
+            auto copyOf = [&](int parent)
+            {
+                Birth birth;
+                birth.parentA = parent;
+                births.push_back(birth);
+            };
             for (int i = 0; i < elites && i < (int)genomes.size(); ++i)
-                next.push_back(genomes[i]);
-            while ((int)next.size() < (int)genomes.size())
-            {
-                int a = std::min((int)genomes.size() - 1, (int)(std::pow(std::uniform_real_distribution<double>(0, 1)(rng), 2) * genomes.size()));
-                int b = std::min((int)genomes.size() - 1, (int)(std::pow(std::uniform_real_distribution<double>(0, 1)(rng), 2) * genomes.size()));
-                const Genome &parentA = genomes[a].fitness > genomes[b].fitness ? genomes[a] : genomes[b];
-                const Genome &parentB = genomes[a].fitness > genomes[b].fitness ? genomes[b] : genomes[a];
-                Genome child = Genome::crossover(parentA, parentB, rng);
-                child.mutateWeights(rng);
-                if (std::uniform_real_distribution<double>(0, 1)(rng) < 0.05)
-                    child.addNode(rng, globalInnov, nextNodeId);
-                if (std::uniform_real_distribution<double>(0, 1)(rng) < 0.2)
-                    child.addConnection(rng, globalInnov);
-                next.push_back(child);
+                copyOf(i);
+            std::vector<int> quota = allocateOffspring((int)genomes.size() - (int)births.size());
+
+            uint64_t key = ((uint64_t)rng() << 32) | rng();
+            for (size_t s = 0; s < species.size(); ++s)
+            {
+                const std::vector<int> &members = species[s].members; // best first
+                int left = quota[s];
+                if (left > 0 && members.size() >= 5 && members[0] >= elites) // a global elite is already copied
+                {
+                    copyOf(members[0]);
+                    --left;
+                }
+                int pool = std::max(1, (int)std::ceil(members.size() * survivalThreshold));
+                for (; left > 0; --left)
+                {
+                    Birth birth;
+                    birth.rng = StreamRng(key, births.size());
+                    auto unit = [&]
+                    { return std::uniform_real_distribution<double>(0, 1)(birth.rng); };
+                    int a = members[std::min(pool - 1, (int)(std::pow(unit(), 2) * pool))];
+                    int b = unit() < interspeciesRate
+                                ? std::min((int)genomes.size() - 1, (int)(unit() * genomes.size()))
+                                : members[std::min(pool - 1, (int)(std::pow(unit(), 2) * pool))];
+                    birth.parentA = genomes[a].fitness > genomes[b].fitness ? a : b;
+                    birth.parentB = genomes[a].fitness > genomes[b].fitness ? b : a;
+                    births.push_back(birth);
+                }
+            }
+
+            // Every parent pair is chosen, so the back arena is sized for exactly these children.
+            std::vector<Genome> &next = spare;
+            next.clear(); // nothing may point into the back arena once it is replaced
+            int back = 1 - front;
+            std::pmr::memory_resource *arena = recycleArena(back, arenaBytes());
+            next.reserve(births.size());
+            for (const Birth &birth : births)
+            {
+                next.emplace_back(arena);
+                reserveFor(birth, next.back());
+            }
+
+            parallelFor((int)births.size(), [this, &next](int i)
+                        {
+                Birth &birth = births[i];
+                Genome &child = next[i];
+                if (birth.parentB < 0)
+                {
+                    child = genomes[birth.parentA];
+                    return;
+                }
+                Genome::crossover(genomes[birth.parentA], genomes[birth.parentB], birth.rng, child);
+                child.mutateWeights(birth.rng, weightPerturbProb, weightStep);
+                std::uniform_real_distribution<double> unit(0, 1);
+                if (unit(birth.rng) < addNodeRate)
+                    birth.split = child.proposeSplit(birth.rng);
+                if (unit(birth.rng) < addLinkRate)
+                    birth.link = child.proposeConnection(birth.rng, birth.newLink); });
+
+            innovations.clear();
+            for (size_t i = 0; i < births.size(); ++i)
+            {
+                Birth &birth = births[i];
+                Genome &child = next[i];
+                if (birth.split >= 0)
+                {
+                    ConnGene old = child.conns[birth.split];
+                    InnovationRegistry::Split genes = innovations.split(old.in, old.out, globalInnov, nextNodeId);
+                    child.insertNode({genes.node, 1});
+                    child.insertConn({old.in, genes.node, 1.0, true, genes.inInnov});
+                    child.insertConn({genes.node, old.out, old.weight, true, genes.outInnov});
+                }
+                if (birth.link)
+                {
+                    birth.newLink.innov = innovations.link(birth.newLink.in, birth.newLink.out, globalInnov);
+                    child.insertConn(birth.newLink);
+                }
             }
+
+            auto unit = [&]
+            { return std::uniform_real_distribution<double>(0, 1)(rng); };
+            for (auto &sp : species) // next generation is compared against a random member of this one
+                sp.representative = genomes[sp.members[std::min((int)sp.members.size() - 1, (int)(unit() * sp.members.size()))]];
             genomes.swap(next);
+            front = back;
+        }
+
+        // Empties arena `which` (no genome may still use it) and makes room for `bytes` of genes.
+        std::pmr::memory_resource *recycleArena(int which, size_t bytes)
+        {
+            size_t blocks = bytes / sizeof(std::max_align_t) + 1;
+            if (arenaBlockCount[which] < blocks)
+            {
+                arenas[which].reset();
+                arenaBlockCount[which] = blocks + blocks / 2;
+                arenaBlocks[which].reset(new std::max_align_t[arenaBlockCount[which]]);
+            }
+            if (arenas[which])
+                arenas[which]->release();
+            else
+                arenas[which] = std::make_unique<std::pmr::monotonic_buffer_resource>(
+                    arenaBlocks[which].get(), arenaBlockCount[which] * sizeof(std::max_align_t));
+            return arenas[which].get();
+        }
+
+        // {nodes, conns} a child needs: its parent's genes for a copy, reserveChild()'s for a bred
+        // child, which already covers the node and links mutation may add.
+        std::pair<size_t, size_t> childCapacity(const Birth &birth) const
+        {
+            const Genome &a = genomes[birth.parentA];
+            if (birth.parentB < 0)
+                return {a.nodes.size(), a.conns.size()};
+            return Genome::childCapacity(a, genomes[birth.parentB]);
+        }
+
+        void reserveFor(const Birth &birth, Genome &child) const
+        {
+            std::pair<size_t, size_t> capacity = childCapacity(birth);
+            child.nodes.reserve(capacity.first);
+            child.conns.reserve(capacity.second);
+        }
+
+        // Gene storage of every child in `births`, each vector padded to the arena's alignment: an
+        // upper bound, so the arena is one upstream block.
+        size_t arenaBytes() const
+        {
+            size_t bytes = 0;
+            for (const Birth &birth : births)
+            {
+                std::pair<size_t, size_t> capacity = childCapacity(birth);
+                bytes += capacity.first * sizeof(NodeGene) + capacity.second * sizeof(ConnGene) + 2 * alignof(std::max_align_t);
+            }
+            return bytes;
         }
 
+        // Text export, kept for debugging and old state files; training checkpoints use Checkpoint.h.
         void serialize(const std::string &filename) const
         {
             std::ofstream os(filename);
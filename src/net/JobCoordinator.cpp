@@ -0,0 +1,184 @@
+#include "JobCoordinator.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+struct JobCoordinator::Run {
+    const std::vector<std::string>* jobs;
+    std::vector<std::string>* results;
+    std::vector<char>* done;
+    size_t remaining;
+};
+
+JobCoordinator::JobCoordinator(const std::string& address, uint16_t port)
+    : listener(Socket::listen(address, port, &listenError)) {
+    if(listener.valid()) acceptor = std::thread([this]{ acceptLoop(); });
+}
+
+JobCoordinator::~JobCoordinator() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    changed.notify_all();
+    if(acceptor.joinable()) acceptor.join();
+    for(auto& link : links) if(link->thread.joinable()) link->thread.join();
+}
+
+void JobCoordinator::acceptLoop() {
+    while(!stopping){
+        {   // reap workers that have gone away
+            std::lock_guard<std::mutex> lock(mutex);
+            for(auto it = links.begin(); it != links.end();){
+                if((*it)->finished){ (*it)->thread.join(); it = links.erase(it); }
+                else ++it;
+            }
+        }
+        if(!listener.waitReadable(200)) continue;
+        Socket s = listener.accept();
+        if(!s.valid()) continue;
+        uint8_t type = 0;
+        std::string hello;
+        if(!s.waitReadable(wire::WORKER_TIMEOUT_MS) || !s.recvMessage(type, hello) || type != wire::HELLO) continue;
+        uint32_t order = 0;
+        if(hello.size() >= 4) std::memcpy(&order, hello.data(), 4);
+        if(order != wire::BYTE_ORDER_MARK){
+            std::cerr << "coordinator: refused a worker with a different byte order" << std::endl;
+            continue;
+        }
+        auto link = std::make_unique<Link>();
+        link->socket = std::move(s);
+        Link* raw = link.get();
+        std::lock_guard<std::mutex> lock(mutex);
+        if(stopping) break;
+        ++liveWorkers;
+        links.push_back(std::move(link));
+        raw->thread = std::thread([this, raw]{ serve(*raw); });
+        changed.notify_all();
+    }
+}
+
+void JobCoordinator::serve(Link& link) {
+    const Socket& s = link.socket;
+    std::pair<Run*, size_t> job{nullptr, 0};
+    using Clock = std::chrono::steady_clock;
+    auto lastHeard = Clock::now();
+    auto silent = [&](Clock::time_point now){ return now - lastHeard >= std::chrono::milliseconds(wire::WORKER_TIMEOUT_MS); };
+    auto alive = [&]{ // drains heartbeats; false once the worker has hung up or sent nothing for WORKER_TIMEOUT_MS
+        uint8_t type;
+        std::string payload;
+        while(s.waitReadable(0)){
+            if(!s.recvMessage(type, payload)) return false;
+            lastHeard = Clock::now();
+        }
+        return !silent(Clock::now());
+    };
+    bool lost = false;
+    for(;;){
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            while(!stopping && queue.empty()){
+                changed.wait_for(lock, std::chrono::milliseconds(wire::HEARTBEAT_MS));
+                lock.unlock();
+                bool ok = alive();
+                lock.lock();
+                if(!ok){ lost = true; break; }
+            }
+            if(lost) break;
+            if(stopping){ lock.unlock(); s.sendMessage(wire::SHUTDOWN, std::string()); break; }
+            job = queue.front();
+            queue.pop_front();
+        }
+
+        uint64_t id;
+        auto deadline = Clock::time_point::max();
+        auto sent = Clock::now();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            id = nextJobId++;
+            if(finishedJobs > 0){
+                double limit = std::max(wire::JOB_DEADLINE_FACTOR * finishedJobSeconds / finishedJobs, wire::WORKER_TIMEOUT_MS / 1000.0);
+                deadline = sent + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(limit));
+            }
+        }
+        const std::string& bytes = (*job.first->jobs)[job.second];
+        std::string message(8 + bytes.size(), '\0');
+        std::memcpy(&message[0], &id, 8);
+        if(!bytes.empty()) std::memcpy(&message[8], bytes.data(), bytes.size());
+        if(!s.sendMessage(wire::JOB, message)){ lost = true; break; }
+
+        std::string reply;
+        bool answered = false, overdue = false;
+        for(;;){
+            auto now = Clock::now();
+            if(!overdue && now >= deadline){
+                // Slow is not dead: the job goes back to the queue for someone else, and this link
+                // waits out the late reply, discarding it, before it takes another job.
+                std::lock_guard<std::mutex> lock(mutex);
+                queue.push_front(job);
+                ++requeued;
+                job.first = nullptr;
+                overdue = true;
+                changed.notify_all();
+            }
+            if(overdue && stopping) break;
+            if(silent(now)) break;
+            auto wake = lastHeard + std::chrono::milliseconds(wire::WORKER_TIMEOUT_MS);
+            if(!overdue) wake = std::min(wake, deadline);
+            else wake = std::min(wake, now + std::chrono::milliseconds(wire::HEARTBEAT_MS)); // to notice stopping
+            int waitMs = (int)std::chrono::duration_cast<std::chrono::milliseconds>(wake - now).count() + 1;
+            if(!s.waitReadable(waitMs)) continue;
+            uint8_t type;
+            if(!s.recvMessage(type, reply)) break; // gone
+            lastHeard = Clock::now();
+            if(type != wire::RESULT || reply.size() < 8) continue; // heartbeat
+            uint64_t got;
+            std::memcpy(&got, reply.data(), 8);
+            if(got == id){ answered = true; break; }
+        }
+        if(!answered){ lost = true; break; }
+        if(overdue) continue;
+        std::lock_guard<std::mutex> lock(mutex);
+        finishedJobSeconds += std::chrono::duration<double>(Clock::now() - sent).count();
+        ++finishedJobs;
+        (*job.first->results)[job.second] = reply.substr(8);
+        (*job.first->done)[job.second] = 1;
+        --job.first->remaining;
+        job.first = nullptr;
+        changed.notify_all();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if(lost && job.first){ // hand the unanswered or overdue job to someone else
+        queue.push_front(job);
+        ++requeued;
+    }
+    --liveWorkers;
+    link.socket.close();
+    link.finished = true;
+    changed.notify_all();
+}
+
+void JobCoordinator::run(const std::vector<std::string>& jobs, std::vector<std::string>& results, std::vector<char>& done, int orphanTimeoutMs) {
+    results.assign(jobs.size(), std::string());
+    done.assign(jobs.size(), 0);
+    if(jobs.empty() || !listening()) return;
+    Run r{&jobs, &results, &done, jobs.size()};
+    std::unique_lock<std::mutex> lock(mutex);
+    for(size_t i=0; i<jobs.size(); ++i) queue.push_back({&r, i});
+    changed.notify_all();
+    auto orphaned = std::chrono::steady_clock::now();
+    while(r.remaining > 0){
+        changed.wait_for(lock, std::chrono::milliseconds(100));
+        auto now = std::chrono::steady_clock::now();
+        if(liveWorkers > 0){ orphaned = now; continue; }
+        if(now - orphaned < std::chrono::milliseconds(orphanTimeoutMs)) continue;
+        // Nobody to run the rest: take it back for the caller. No job can be in flight here.
+        for(auto it = queue.begin(); it != queue.end();){
+            if(it->first == &r) it = queue.erase(it);
+            else ++it;
+        }
+        break;
+    }
+}
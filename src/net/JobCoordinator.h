@@ -0,0 +1,78 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Socket.h"
+
+// Message types shared by JobCoordinator and serveJobs().
+namespace wire {
+enum : uint8_t {
+    HELLO = 1,     // worker -> coordinator, payload: uint32 BYTE_ORDER_MARK + worker description
+    JOB = 2,       // coordinator -> worker, payload: uint64 job id + job bytes
+    RESULT = 3,    // worker -> coordinator, payload: uint64 job id + result bytes
+    HEARTBEAT = 4, // worker -> coordinator, empty, sent every HEARTBEAT_MS even while busy
+    SHUTDOWN = 5,  // coordinator -> worker, empty
+};
+constexpr int HEARTBEAT_MS = 1000;
+constexpr int WORKER_TIMEOUT_MS = 5 * HEARTBEAT_MS; // silence after which a worker is presumed dead
+constexpr int JOB_DEADLINE_FACTOR = 10;             // a job may take this many times the mean job time
+constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;    // as written by the sender; payloads are native order
+}
+
+// Hands opaque job payloads to remote worker processes and collects their results.
+// Workers connect whenever they like; each gets a thread that sends it one job at a time.
+// A worker that hangs up or stays silent past WORKER_TIMEOUT_MS, busy or idle, is dropped and its
+// job goes back to the queue for another worker. A job held past its deadline (JOB_DEADLINE_FACTOR
+// times the mean time of the jobs finished so far, and never less than WORKER_TIMEOUT_MS) is
+// queued again too, but the worker keeps its link: it gets its next job once the late reply,
+// which is discarded, arrives. Workers whose HELLO carries another byte order are refused.
+class JobCoordinator {
+public:
+    JobCoordinator(const std::string& address, uint16_t port);
+    ~JobCoordinator(); // sends SHUTDOWN to every worker
+    JobCoordinator(const JobCoordinator&) = delete;
+    JobCoordinator& operator=(const JobCoordinator&) = delete;
+
+    bool listening() const { return listener.valid(); }
+    const std::string& error() const { return listenError; }
+    int workers() const { return liveWorkers.load(); }
+
+    // Runs every job remotely and fills results[i] for job i, setting done[i]. Returns early,
+    // leaving jobs undone, when no worker has been connected for `orphanTimeoutMs`; the caller
+    // runs those itself.
+    void run(const std::vector<std::string>& jobs, std::vector<std::string>& results, std::vector<char>& done, int orphanTimeoutMs = 2000);
+
+    uint64_t redispatched() const { return requeued.load(); }
+
+private:
+    struct Run;
+    struct Link {
+        Socket socket;
+        std::thread thread;
+        std::atomic<bool> finished{false};
+    };
+
+    void acceptLoop();
+    void serve(Link& link);
+
+    Socket listener;
+    std::string listenError;
+    std::thread acceptor;
+    std::atomic<bool> stopping{false};
+    std::atomic<int> liveWorkers{0};
+    std::atomic<uint64_t> requeued{0};
+    double finishedJobSeconds = 0; // guarded by mutex, like finishedJobs
+    uint64_t finishedJobs = 0;
+
+    std::mutex mutex;
+    std::condition_variable changed; // job queued, job finished or worker lost
+    std::deque<std::pair<Run*, size_t>> queue;
+    std::vector<std::unique_ptr<Link>> links;
+    uint64_t nextJobId = 1;
+};
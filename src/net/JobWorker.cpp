@@ -0,0 +1,50 @@
+#include "JobWorker.h"
+#include "JobCoordinator.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+bool serveJobs(const std::string& host, uint16_t port, const std::string& description,
+               const std::function<std::string(const std::string&)>& handler, std::string* error) {
+    Socket s = Socket::connect(host, port, error);
+    if(!s.valid()) return false;
+    std::mutex sending; // heartbeats and results share the socket
+    auto send = [&](uint8_t type, const std::string& payload){
+        std::lock_guard<std::mutex> lock(sending);
+        return s.sendMessage(type, payload);
+    };
+    std::string hello(4, '\0');
+    std::memcpy(&hello[0], &wire::BYTE_ORDER_MARK, 4);
+    if(!send(wire::HELLO, hello + description)){
+        if(error) *error = "coordinator closed the connection";
+        return false;
+    }
+
+    std::mutex mutex;
+    std::condition_variable stop;
+    bool stopping = false;
+    std::thread heartbeat([&]{
+        std::unique_lock<std::mutex> lock(mutex);
+        while(!stop.wait_for(lock, std::chrono::milliseconds(wire::HEARTBEAT_MS), [&]{ return stopping; }))
+            if(!send(wire::HEARTBEAT, std::string())) break;
+    });
+
+    uint8_t type;
+    std::string message;
+    while(s.recvMessage(type, message)){
+        if(type == wire::SHUTDOWN) break;
+        if(type != wire::JOB || message.size() < 8) continue;
+        std::string reply = message.substr(0, 8) + handler(message.substr(8));
+        if(!send(wire::RESULT, reply)) break;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    stop.notify_all();
+    heartbeat.join();
+    return true;
+}
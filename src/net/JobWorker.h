@@ -0,0 +1,10 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <string>
+
+// Worker side of JobCoordinator: connects, announces itself, then answers JOB messages with
+// handler(job bytes) until the coordinator sends SHUTDOWN or hangs up. A background thread keeps
+// heartbeats flowing while the handler runs. Returns false if the connection could not be made.
+bool serveJobs(const std::string& host, uint16_t port, const std::string& description,
+               const std::function<std::string(const std::string&)>& handler, std::string* error = nullptr);
@@ -0,0 +1,188 @@
+#include "Socket.h"
+#include <algorithm>
+#include <cstring>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+namespace {
+struct WinsockInit {
+    WinsockInit(){ WSADATA data; WSAStartup(MAKEWORD(2, 2), &data); }
+    ~WinsockInit(){ WSACleanup(); }
+};
+void ensureWinsock(){ static WinsockInit init; }
+using SockLen = int;
+int closeHandle(SOCKET s){ return closesocket(s); }
+int pollHandles(WSAPOLLFD* fds, ULONG n, int timeout){ return WSAPoll(fds, n, timeout); }
+using PollFd = WSAPOLLFD;
+const int SEND_FLAGS = 0;
+const int SHUT_BOTH = SD_BOTH;
+}
+#else
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+namespace {
+void ensureWinsock(){}
+using SockLen = socklen_t;
+int closeHandle(int s){ return ::close(s); }
+int pollHandles(pollfd* fds, nfds_t n, int timeout){ return ::poll(fds, n, timeout); }
+using PollFd = pollfd;
+#ifdef MSG_NOSIGNAL
+const int SEND_FLAGS = MSG_NOSIGNAL; // a dead peer must not kill the trainer with SIGPIPE
+#else
+const int SEND_FLAGS = 0;
+#endif
+const int SHUT_BOTH = SHUT_RDWR;
+}
+#endif
+
+namespace {
+void setError(std::string* error, const std::string& what){ if(error) *error = what; }
+}
+
+Socket::Handle Socket::invalid() {
+#ifdef _WIN32
+    return (Handle)INVALID_SOCKET;
+#else
+    return -1;
+#endif
+}
+
+Socket& Socket::operator=(Socket&& other) noexcept {
+    if(this != &other){
+        close();
+        handle = other.handle;
+        other.handle = invalid();
+    }
+    return *this;
+}
+
+void Socket::close() {
+    if(valid()) closeHandle(handle);
+    handle = invalid();
+}
+
+void Socket::shutdown() {
+    if(valid()) ::shutdown(handle, SHUT_BOTH);
+}
+
+Socket Socket::listen(const std::string& address, uint16_t port, std::string* error) {
+    ensureWinsock();
+    Socket s(::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP));
+    if(!s.valid()){ setError(error, "socket() failed"); return Socket(); }
+    int yes = 1;
+    setsockopt(s.handle, SOL_SOCKET, SO_REUSEADDR, (const char*)&yes, sizeof yes);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if(inet_pton(AF_INET, address.c_str(), &addr.sin_addr) != 1){ setError(error, "bad listen address " + address); return Socket(); }
+    if(::bind(s.handle, (const sockaddr*)&addr, sizeof addr) != 0){ setError(error, "cannot bind " + address + ":" + std::to_string(port)); return Socket(); }
+    if(::listen(s.handle, 64) != 0){ setError(error, "listen() failed"); return Socket(); }
+    return s;
+}
+
+Socket Socket::connect(const std::string& host, uint16_t port, std::string* error) {
+    ensureWinsock();
+    addrinfo hints{};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* found = nullptr;
+    if(getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &found) != 0 || !found){
+        setError(error, "cannot resolve " + host);
+        return Socket();
+    }
+    Socket s;
+    for(addrinfo* a = found; a && !s.valid(); a = a->ai_next){
+        Socket attempt(::socket(a->ai_family, a->ai_socktype, a->ai_protocol));
+        if(attempt.valid() && ::connect(attempt.handle, a->ai_addr, (SockLen)a->ai_addrlen) == 0) s = std::move(attempt);
+    }
+    freeaddrinfo(found);
+    if(!s.valid()){ setError(error, "cannot connect to " + host + ":" + std::to_string(port)); return s; }
+    int yes = 1;
+    setsockopt(s.handle, IPPROTO_TCP, TCP_NODELAY, (const char*)&yes, sizeof yes); // small replies go out at once
+    return s;
+}
+
+Socket Socket::accept() const {
+    Socket s(::accept(handle, nullptr, nullptr));
+    if(s.valid()){
+        int yes = 1;
+        setsockopt(s.handle, IPPROTO_TCP, TCP_NODELAY, (const char*)&yes, sizeof yes);
+    }
+    return s;
+}
+
+bool Socket::waitReadable(int timeoutMs) const {
+    PollFd p{};
+    p.fd = handle;
+    p.events = POLLIN;
+    return pollHandles(&p, 1, timeoutMs) > 0;
+}
+
+bool Socket::sendAll(const void* data, size_t bytes) const {
+    const char* p = (const char*)data;
+    while(bytes > 0){
+        int chunk = (int)std::min<size_t>(bytes, 1 << 20);
+        auto sent = ::send(handle, p, chunk, SEND_FLAGS);
+        if(sent <= 0) return false;
+        p += sent;
+        bytes -= (size_t)sent;
+    }
+    return true;
+}
+
+bool Socket::recvAll(void* data, size_t bytes) const {
+    char* p = (char*)data;
+    while(bytes > 0){
+        int chunk = (int)std::min<size_t>(bytes, 1 << 20);
+        auto got = ::recv(handle, p, chunk, 0);
+        if(got <= 0) return false;
+        p += got;
+        bytes -= (size_t)got;
+    }
+    return true;
+}
+
+bool Socket::sendMessage(uint8_t type, const std::string& payload) const {
+    if(payload.size() > MAX_MESSAGE) return false;
+    std::string frame(5 + payload.size(), '\0');
+    uint32_t length = (uint32_t)payload.size();
+    std::memcpy(&frame[0], &length, 4);
+    frame[4] = (char)type;
+    if(!payload.empty()) std::memcpy(&frame[5], payload.data(), payload.size());
+    return sendAll(frame.data(), frame.size());
+}
+
+bool Socket::recvMessage(uint8_t& type, std::string& payload) const {
+    unsigned char head[5];
+    if(!recvAll(head, sizeof head)) return false;
+    uint32_t length;
+    std::memcpy(&length, head, 4);
+    if(length > MAX_MESSAGE) return false;
+    type = head[4];
+    payload.resize(length);
+    return length == 0 || recvAll(&payload[0], length);
+}
+
+bool splitEndpoint(const std::string& endpoint, std::string& host, uint16_t& port) {
+    size_t colon = endpoint.rfind(':');
+    std::string digits = colon == std::string::npos ? endpoint : endpoint.substr(colon + 1);
+    host = colon == std::string::npos ? "127.0.0.1" : endpoint.substr(0, colon);
+    if(digits.empty() || digits.find_first_not_of("0123456789") != std::string::npos || digits.size() > 5) return false;
+    unsigned long value = std::stoul(digits);
+    if(value == 0 || value > 65535) return false;
+    port = (uint16_t)value;
+    if(host.empty()) host = "127.0.0.1";
+    return true;
+}
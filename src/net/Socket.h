@@ -0,0 +1,49 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+// Blocking TCP socket (POSIX or Winsock) plus the framing every message uses:
+// [uint32 payload length][uint8 type][payload], integers in the sender's native order. Peers
+// must share a byte order; JobCoordinator checks the mark each worker sends in its HELLO.
+class Socket {
+public:
+#ifdef _WIN32
+    using Handle = uintptr_t;
+#else
+    using Handle = int;
+#endif
+
+    Socket() = default;
+    ~Socket() { close(); }
+    Socket(Socket&& other) noexcept : handle(other.handle) { other.handle = invalid(); }
+    Socket& operator=(Socket&& other) noexcept;
+    Socket(const Socket&) = delete;
+    Socket& operator=(const Socket&) = delete;
+
+    // Listens on address:port ("127.0.0.1" for local workers, "0.0.0.0" for a cluster).
+    static Socket listen(const std::string& address, uint16_t port, std::string* error = nullptr);
+    static Socket connect(const std::string& host, uint16_t port, std::string* error = nullptr);
+    Socket accept() const;
+
+    bool valid() const { return handle != invalid(); }
+    void close();
+    // Stops pending and future reads and writes from any thread; the socket stays open until close().
+    void shutdown();
+
+    // True if data (or a hang-up) arrives within timeoutMs.
+    bool waitReadable(int timeoutMs) const;
+    bool sendAll(const void* data, size_t bytes) const;
+    bool recvAll(void* data, size_t bytes) const;
+
+    static constexpr uint32_t MAX_MESSAGE = 64u << 20;
+    bool sendMessage(uint8_t type, const std::string& payload) const;
+    bool recvMessage(uint8_t& type, std::string& payload) const;
+
+private:
+    explicit Socket(Handle h) : handle(h) {}
+    static Handle invalid();
+    Handle handle = invalid();
+};
+
+// "host:port" -> parts; false if the port is missing or out of range.
+bool splitEndpoint(const std::string& endpoint, std::string& host, uint16_t& port);
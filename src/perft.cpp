@@ -0,0 +1,177 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstdlib>
+#include <algorithm>
+#include "game/Board.h"
+#include "game/Tetrimino.h"
+
+// Move-generation perft, as in chess engines: from fixed boards and piece sequences, expands
+// every placement sequence to depth N and counts the leaves. Each leaf also adds its board's
+// Zobrist hash to a checksum, so a generator that finds the same number of placements but lands
+// a piece somewhere else still fails. Boards that top out are leaves, as in playGame; line
+// clears are applied, garbage lines are not. Counts up to GOLDEN_DEPTH are checked against
+// golden values recorded from each generator; deeper runs only measure throughput.
+//
+// Generators: reference (Board::allPossiblePlacements), canonical (Board::canonicalPlacements),
+// and check, which walks the canonical tree and at every node also requires the canonical list
+// to reach exactly the distinct boards of the reference list, each once.
+//
+// usage: perft [depth = GOLDEN_DEPTH] [reference | canonical | check]
+
+const int GOLDEN_DEPTH = 4;
+
+enum class Generator { Reference, Canonical, Check };
+
+struct Golden {
+    uint64_t nodes[GOLDEN_DEPTH];
+    uint64_t checksum[GOLDEN_DEPTH];
+};
+
+struct PerftPosition {
+    const char *name;
+    std::vector<int> garbageHoles; // pushed up from the bottom in order, before the first piece
+    const char *pieces;            // one of IOTLJSZ per ply
+    Golden reference, canonical;
+};
+
+const PerftPosition POSITIONS[] = {
+    {"empty", {}, "TISZ",
+     {{58, 1682, 48778, 1414562},
+      {12617960497209980908ull, 17108956768217667406ull, 8946604093572612561ull, 4910364645591555514ull}},
+     {{58, 1682, 48778, 1414562},
+      {12617960497209980908ull, 17108956768217667406ull, 8946604093572612561ull, 4910364645591555514ull}}},
+    {"garbage", {3, 7, 7, 12, 0, 15}, "LJOT",
+     {{58, 3364, 50460, 2926680},
+      {297605943095177440ull, 6551102943855067468ull, 4580224445677499610ull, 18421886891532934192ull}},
+     {{58, 3364, 50460, 2926680},
+      {297605943095177440ull, 6551102943855067468ull, 4580224445677499610ull, 18421886891532934192ull}}},
+    {"well", {15, 15, 15, 15, 15, 15, 15, 15, 15, 15}, "IOIZ",
+     {{29, 435, 12615, 365835},
+      {7127825127339545176ull, 11485100169995495209ull, 11070705728876995591ull, 16948748062101965156ull}},
+     {{29, 435, 12615, 365835},
+      {7127825127339545176ull, 11485100169995495209ull, 11070705728876995591ull, 16948748062101965156ull}}},
+    {"near-top", {1, 4, 9, 9, 2, 14, 6, 11, 0, 5, 8, 13, 3, 10, 7, 12, 15, 2}, "SZTI",
+     {{29, 841, 39487, 675853},
+      {13340407399826797913ull, 11500101279471891579ull, 9676853550124402150ull, 840310807372157436ull}},
+     {{29, 841, 38135, 674501},
+      {13340407399826797913ull, 11500101279471891579ull, 3577168023270036456ull, 13187369354227343358ull}}},
+};
+
+TetrominoType pieceType(char c){
+    switch(c){
+    case 'I': return TetrominoType::I;
+    case 'O': return TetrominoType::O;
+    case 'T': return TetrominoType::T;
+    case 'L': return TetrominoType::L;
+    case 'J': return TetrominoType::J;
+    case 'S': return TetrominoType::S;
+    default: return TetrominoType::Z;
+    }
+}
+
+struct Count {
+    uint64_t nodes = 0;
+    uint64_t checksum = 0;
+    uint64_t badNodes = 0; // check: nodes where the two generators disagree
+};
+
+// Hashes of the boards the listed placements lead to, sorted.
+std::vector<uint64_t> resultingBoards(const Board &board, const Tetromino &tet, const PlacementBuffer &placements){
+    std::vector<uint64_t> hashes;
+    for(int i=0; i<placements.size(); ++i){
+        Board next = board;
+        next.applyPlacement(placements[i], tet);
+        hashes.push_back(next.hash());
+    }
+    std::sort(hashes.begin(), hashes.end());
+    return hashes;
+}
+
+// One buffer per ply so a level's candidates survive the recursion below it.
+void perft(const Board &board, const char *pieces, int depth, Generator generator, std::vector<PlacementBuffer> &buffers,
+           EnumerationStats &stats, Count &count){
+    Tetromino tet(pieceType(pieces[0]));
+    PlacementBuffer &placements = buffers[depth];
+    if(generator == Generator::Reference){
+        board.allPossiblePlacements(tet, placements);
+    } else {
+        board.canonicalPlacements(tet, placements, &stats);
+    }
+    if(generator == Generator::Check){
+        PlacementBuffer reference;
+        board.allPossiblePlacements(tet, reference);
+        std::vector<uint64_t> expected = resultingBoards(board, tet, reference), got = resultingBoards(board, tet, placements);
+        expected.erase(std::unique(expected.begin(), expected.end()), expected.end());
+        if(got != expected) count.badNodes++;
+    }
+    for(int i=0; i<placements.size(); ++i){
+        Board next = board;
+        next.applyPlacement(placements[i], tet);
+        if(depth == 1 || next.isGameOver()){
+            count.nodes++;
+            count.checksum += next.hash();
+        } else {
+            perft(next, pieces + 1, depth - 1, generator, buffers, stats, count);
+        }
+    }
+}
+
+int main(int argc, char **argv){
+    int maxDepth = argc > 1 ? std::atoi(argv[1]) : GOLDEN_DEPTH;
+    std::string name = argc > 2 ? argv[2] : "reference";
+    Generator generator = name == "canonical" ? Generator::Canonical : name == "check" ? Generator::Check : Generator::Reference;
+    if(maxDepth < 1 || argc > 3 || (generator == Generator::Reference && name != "reference")){
+        std::cerr << "usage: " << argv[0] << " [depth = " << GOLDEN_DEPTH << "] [reference | canonical | check]" << std::endl;
+        return 1;
+    }
+    EnumerationStats stats;
+    std::vector<PlacementBuffer> buffers(maxDepth + 1);
+    bool ok = true;
+    uint64_t totalNodes = 0;
+    double totalSeconds = 0;
+
+    std::cout << std::left << std::setw(10) << "position" << std::right << std::setw(6) << "depth"
+              << std::setw(14) << "nodes" << std::setw(22) << "checksum" << std::setw(14) << "nodes/sec" << "  golden\n";
+    for(const PerftPosition &pos : POSITIONS){
+        Board root;
+        for(int hole : pos.garbageHoles) root.addGarbageLine(hole);
+        int plies = (int)std::char_traits<char>::length(pos.pieces);
+        for(int depth=1; depth<=maxDepth; ++depth){
+            std::string pieces;
+            for(int d=0; d<depth; ++d) pieces += pos.pieces[d % plies];
+            Count count;
+            auto start = std::chrono::steady_clock::now();
+            perft(root, pieces.c_str(), depth, generator, buffers, stats, count);
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            totalNodes += count.nodes;
+            totalSeconds += seconds;
+
+            std::string verdict = "-";
+            const Golden &golden = generator == Generator::Reference ? pos.reference : pos.canonical;
+            if(depth <= GOLDEN_DEPTH){
+                bool match = count.nodes == golden.nodes[depth - 1] && count.checksum == golden.checksum[depth - 1];
+                verdict = match ? "ok" : "MISMATCH (expected " + std::to_string(golden.nodes[depth - 1]) + " / " + std::to_string(golden.checksum[depth - 1]) + ")";
+                ok = ok && match;
+            }
+            if(count.badNodes){
+                verdict += ", " + std::to_string(count.badNodes) + " nodes reach other boards than the reference";
+                ok = false;
+            }
+            std::cout << std::left << std::setw(10) << pos.name << std::right << std::setw(6) << depth
+                      << std::setw(14) << count.nodes << std::setw(22) << count.checksum
+                      << std::setw(14) << (uint64_t)(seconds > 0 ? count.nodes / seconds : 0) << "  " << verdict << "\n";
+        }
+    }
+    std::cout << "total " << totalNodes << " nodes in " << std::fixed << std::setprecision(3) << totalSeconds << " s, "
+              << std::setprecision(0) << (totalSeconds > 0 ? totalNodes / totalSeconds : 0.0) << " nodes/sec\n";
+    if(generator != Generator::Reference){
+        std::cout << "canonical enumeration: " << stats.emitted << " of " << stats.reference << " reference placements kept, "
+                  << stats.duplicates() << " duplicate boards removed\n";
+    }
+    std::cout << (ok ? "perft: all golden counts match" : "perft: MISMATCH against the reference move generator") << std::endl;
+    return ok ? 0 : 1;
+}
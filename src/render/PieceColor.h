@@ -0,0 +1,16 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include "game/Tetrimino.h"
+
+inline sf::Color pieceColor(TetrominoType t) {
+    switch (t) {
+        case TetrominoType::I: return sf::Color::Cyan;
+        case TetrominoType::O: return sf::Color::Yellow;
+        case TetrominoType::T: return sf::Color(128,0,128);
+        case TetrominoType::L: return sf::Color(255,165,0);
+        case TetrominoType::J: return sf::Color::Blue;
+        case TetrominoType::S: return sf::Color::Green;
+        case TetrominoType::Z: return sf::Color::Red;
+    }
+    return sf::Color::White;
+}
@@ -3,115 +3,350 @@
 #include <random>
 #include <chrono>
 #include <thread>
-#include <future>
+#include <functional>
 #include <vector>
 #include <algorithm>
+#include <map>
+#include <cmath>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include "game/Bag.h"
 #include "game/Board.h"
+#include "game/PlacementCache.h"
 #include "game/Tetrimino.h"
+#include "neat/Checkpoint.h"
+#include "neat/CheckpointWriter.h"
+#include "neat/Islands.h"
 #include "neat/NEAT.h"
+#include "net/JobCoordinator.h"
+#include "net/JobWorker.h"
+#include "util/FitnessCache.h"
+#include "util/Profile.h"
+#include "util/SeedSchedule.h"
+#include "util/ThreadPool.h"
 
 // --- CONFIGURATION FOR METRICS ---
 const bool PARALLEL_EXECUTION = true;
+const bool USE_PLACEMENT_CACHE = true;
+const neat::Precision INFERENCE_PRECISION = neat::Precision::Double; // inference_report: Float/Int8 agreement; bench --filter precision: speed
+const int CHECKPOINT_INTERVAL = 1;    // generations between population checkpoints (the last one is always saved)
+const int CHECKPOINT_QUEUE_DEPTH = 2; // pending writes before the training loop waits for the disk
+const int NUM_GAMES_PER_EVAL = 3;     // fixed budget per genome; fitness is always scaled to this many games
+const int MAX_PIECES = 500;           // pieces per game
+const bool RACING_EVALUATION = true;  // play games in rounds and stop genomes that cannot make the cut
+const int RACE_MAX_GAMES = 8;         // games a genome can earn by staying in the race
+const double RACE_KEEP_FRACTION = 0.25;  // the race settles who belongs in this top fraction
+const double RACE_CONFIDENCE = 2.0;      // upper confidence bound width, in standard errors
+const SeedSchedule SEED_SCHEDULE = SeedSchedule::rotating(); // window slides one seed per generation
+const bool USE_FITNESS_CACHE = true;  // reuse games already played by an identical genome on the same seed
+const int FITNESS_CACHE_MAX_AGE = 2;  // generations an unused cached game is kept
+const std::string LISTEN_ADDRESS = "127.0.0.1"; // --listen PORT binds here; pass 0.0.0.0:PORT for cluster workers
+const int GENOMES_PER_MESSAGE = 8;    // genomes (each with all its seeds) batched into one job for a remote worker
+const int ISLANDS = 1;                // independent populations, one thread each; --islands K overrides
+const int MIGRATION_INTERVAL = 5;     // generations between champion migrations around the island ring
+const int MIGRANTS = 2;               // champions sent to the next island each migration
+const std::string TRACE_FILE = "trace.json"; // Chrome trace of a -DTETRIS_PROFILE=ON build
+struct MutationRates { double weightStep, addNode, addLink; };
+// Island k evolves with entry k % 4, so one run also compares mutation settings. Entry 0 is the default.
+const MutationRates ISLAND_MUTATION_RATES[] = {{0.5, 0.05, 0.2}, {0.25, 0.03, 0.1}, {1.0, 0.08, 0.3}, {0.5, 0.1, 0.4}};
 
-// 549ms -> one generation -> with parallelisation
-// 2669ms -> one generation -> without parallelisation
-
-class Bag {
-    std::vector<TetrominoType> bag;
-    std::mt19937 rng;
-public:
-    Bag(int seed=123): rng(seed) { refill(); }
-    void refill(){
-        bag = {TetrominoType::I, TetrominoType::O, TetrominoType::T, TetrominoType::L, TetrominoType::J, TetrominoType::S, TetrominoType::Z};
-        std::shuffle(bag.begin(), bag.end(), rng);
-    }
-    TetrominoType next(){
-        if(bag.empty()) refill();
-        TetrominoType t = bag.back(); bag.pop_back();
-        return t;
-    }
+// Generation time is printed every generation next to the pool size. It is not comparable with
+// `bench --filter e2e`, which plays games with its own copy of the loop: no racing, no fitness or
+// placement cache, and a fixed heuristic player or a fresh population instead of a trained one.
+
+// Shared by every genome: all games start from an empty board with the same early pieces,
+// so identical (board, piece) positions come up again and again within a generation.
+PlacementCache placementCache;
+
+struct GameResult {
+    int lines = 0;
+    int pieces = 0;
+};
+
+// Buffers one pool worker reuses for every game it plays.
+struct GameScratch {
+    Board board;
+    PlacementBuffer placements;
+    neat::Activations activations;
+    EnumerationStats enumeration; // candidates move generation dropped, since the last report
+    PlacementCache::Stats placementLookups; // this worker's cache hits and misses, since the last report
 };
 
-int linesClearedInGame(const neat::Genome &g, int seed){
-    Board b;
+
+GameResult playGame(const neat::Phenotype &net, int seed, GameScratch &scratch){
+    PROFILE_SCOPE("game");
+    Board &b = scratch.board;
+    PlacementBuffer &placements = scratch.placements;
+    b.clear();
     Bag bag(seed);
+    GarbageHoles holes(seed);
     int totalLines = 0;
     int pieceCount = 0;
-    const int maxPieces = 500;
     const int garbageFrequency = 25;
 
     auto makeTet = [](TetrominoType t){ return Tetromino(t); };
-    while(pieceCount < maxPieces){
+    while(pieceCount < MAX_PIECES){
         Tetromino tet(makeTet(bag.next()));
-        auto placements = b.allPossiblePlacements(tet);
+        if(USE_PLACEMENT_CACHE) placementCache.canonicalPlacements(b, tet, placements, &scratch.enumeration, &scratch.placementLookups);
+        else b.canonicalPlacements(tet, placements, &scratch.enumeration);
         if(placements.empty()) break;
-        double bestScore = -1e9;
-        int bestIdx = -1;
-        for(size_t i=0;i<placements.size();++i){
-            auto &p = placements[i];
-            std::vector<double> inputs = { (double)p.aggregateHeight/400.0, (double)p.holes/400.0, (double)p.bumpiness/400.0, (double)p.clearedLines/4.0 };
-            double score = g.evaluate(inputs);
-            if(score > bestScore){ bestScore = score; bestIdx = i; }
-        }
+        int bestIdx = net.argmax(placements.featureColumns().data(), PlacementBuffer::NUM_FEATURES, placements.size(), scratch.activations);
+        PROFILE_COUNT(NetworkEvaluations, placements.size());
         if(bestIdx<0) break;
 
         b.applyPlacement(placements[bestIdx], tet);
-        totalLines += placements[bestIdx].clearedLines;
+        totalLines += placements.clearedLines[bestIdx];
         pieceCount++;
 
         if (pieceCount > 0 && pieceCount % garbageFrequency == 0) {
-            b.addGarbageLine();
+            b.addGarbageLine(holes.next(Board::WIDTH));
         }
 
-        if(b.isGameOver()) break;
+        if(b.isGameOver()){
+            PROFILE_COUNT(GamesAborted, 1);
+            break;
+        }
     }
-    return totalLines;
+    PROFILE_COUNT(PiecesSimulated, pieceCount);
+    return {totalLines, pieceCount};
 }
 
-void evaluate_genome_fitness(neat::Genome &g, int gen){
-    const int NUM_GAMES_PER_EVAL = 3;
-    int fitness = 0;
-    for(int s=0; s<NUM_GAMES_PER_EVAL; ++s){
-        fitness += linesClearedInGame(g, gen*10000 + g.nodes[0].id * 10 + s);
+// Remote evaluation. A job is [u8 precision][u32 genome count], then per genome its checkpoint
+// record and [u32 seed count][i32 seeds]; the reply is [i32 lines][i32 pieces] per game, in order.
+// Games are deterministic, so a worker's results are exactly what the local pool would produce.
+std::string playJob(const std::string &job, ThreadPool &pool, std::vector<GameScratch> &scratch){
+    if(job.size() < 5 || (uint8_t)job[0] > (uint8_t)neat::Precision::Int8) return std::string();
+    neat::Precision precision = (neat::Precision)job[0];
+    uint32_t count;
+    std::memcpy(&count, &job[1], 4);
+    size_t at = 5;
+    std::vector<neat::Phenotype> nets;
+    std::vector<std::pair<int, int>> tasks;
+    for(uint32_t i=0; i<count; ++i){
+        neat::Genome g;
+        uint32_t seeds;
+        if(!neat::readGenome(job, at, g) || job.size() - at < 4) return std::string();
+        std::memcpy(&seeds, &job[at], 4);
+        at += 4;
+        if((job.size() - at) / 4 < seeds) return std::string();
+        nets.emplace_back(g, precision);
+        for(uint32_t k=0; k<seeds; ++k, at += 4){
+            int32_t seed;
+            std::memcpy(&seed, &job[at], 4);
+            tasks.push_back({(int)i, seed});
+        }
+    }
+    std::vector<GameResult> played(tasks.size());
+    pool.parallelFor((int)tasks.size(), [&](int task, int worker){
+        played[task] = playGame(nets[tasks[task].first], tasks[task].second, scratch[worker]);
+    });
+    std::string reply(played.size() * 8, '\0');
+    for(size_t t=0; t<played.size(); ++t){
+        int32_t fields[2] = {played[t].lines, played[t].pieces};
+        std::memcpy(&reply[t * 8], fields, 8);
     }
-    g.fitness = fitness;
+    return reply;
 }
 
-int main(){
-    const int POP = 100;
-    const int INPUTS = 4;
-    const int OUTPUTS = 1;
-    const std::string POP_STATE_FILE = "population_state.txt";
-    
-    neat::Population pop;
-    std::ifstream state_in(POP_STATE_FILE);
-    if(state_in.is_open()) {
-        std::cout << "Resuming training from " << POP_STATE_FILE << std::endl;
-        pop = neat::Population::deserialize(POP_STATE_FILE);
-    } else {
-        std::cout << "Starting new training session." << std::endl;
-        pop = neat::Population(POP, INPUTS, OUTPUTS, (int)std::chrono::system_clock::now().time_since_epoch().count());
+// Sends the (genome, seed) tasks to the coordinator's workers, GENOMES_PER_MESSAGE genomes per
+// job, and fills played[t] / done[t] for every task a worker answered.
+void playRemotely(const std::vector<neat::Genome> &genomes, const std::vector<std::pair<int, int>> &tasks,
+                  std::vector<GameResult> &played, std::vector<char> &done, JobCoordinator &coordinator){
+    PROFILE_SCOPE("remote games");
+    std::vector<std::string> jobs;
+    std::vector<std::vector<size_t>> jobTasks;
+    for(size_t t=0; t<tasks.size();){
+        std::string job(5, '\0');
+        job[0] = (char)INFERENCE_PRECISION;
+        std::vector<size_t> members;
+        uint32_t count = 0;
+        for(; t<tasks.size() && count < (uint32_t)GENOMES_PER_MESSAGE; ++count){
+            int g = tasks[t].first; // a genome's tasks are consecutive
+            neat::appendGenome(genomes[g], job);
+            size_t seedsAt = job.size();
+            job.append(4, '\0');
+            uint32_t seeds = 0;
+            for(; t<tasks.size() && tasks[t].first == g; ++t, ++seeds){
+                int32_t seed = tasks[t].second;
+                job.append((const char*)&seed, 4);
+                members.push_back(t);
+            }
+            std::memcpy(&job[seedsAt], &seeds, 4);
+        }
+        std::memcpy(&job[1], &count, 4);
+        jobs.push_back(std::move(job));
+        jobTasks.push_back(std::move(members));
     }
-    
-    // Setup for logging
-    std::ofstream log_file("training_log.csv");
-    log_file << "Generation,AverageFitness,BestFitness,BestFitnessAvgPerGame\n";
+    std::vector<std::string> replies;
+    std::vector<char> answered;
+    coordinator.run(jobs, replies, answered);
+    for(size_t j=0; j<jobs.size(); ++j){
+        if(!answered[j] || replies[j].size() != jobTasks[j].size() * 8) continue;
+        for(size_t k=0; k<jobTasks[j].size(); ++k){
+            int32_t fields[2];
+            std::memcpy(fields, &replies[j][k * 8], 8);
+            played[jobTasks[j][k]] = {fields[0], fields[1]};
+            done[jobTasks[j][k]] = 1;
+        }
+    }
+}
 
-    const int GENERATIONS = 50;
+struct EvaluationStats {
+    long long pieces = 0;      // pieces actually simulated
+    long long fixedBudget = 0; // upper bound of the fixed mode: every genome plays NUM_GAMES_PER_EVAL full games
+    int games = 0;
+    int mostGames = 0;         // games played by the best-evaluated genome
+    int remoteGames = 0;       // games played by --worker processes
+};
+
+// Plays games in rounds, one pool task per game (genome, seed). Without racing that is a single
+// round of NUM_GAMES_PER_EVAL games each. With racing, every genome first plays 2 games; after
+// each round a genome keeps playing only while its upper confidence bound
+// mean + RACE_CONFIDENCE * sigma / sqrt(games) still reaches the current top-RACE_KEEP_FRACTION
+// mean, and while the extra games fit in the fixed budget's pieces. The pieces saved on hopeless
+// genomes buy up to RACE_MAX_GAMES games for the contenders. Fitness is mean lines per game
+// scaled to NUM_GAMES_PER_EVAL games, so both modes report on the same scale. Game k uses
+// SEED_SCHEDULE.seed(gen, k); games found in `fitnessCache` (keyed by genome content hash and seed;
+// seeded games are fully deterministic) are not replayed and cost no pieces.
+// With a coordinator that has workers connected, each round's games go to them first; whatever
+// they could not finish is played on the local pool.
+EvaluationStats evaluate_population(std::vector<neat::Genome> &genomes, int gen, ThreadPool &pool, std::vector<GameScratch> &scratch,
+                                    FitnessCache<GameResult> &fitnessCache, JobCoordinator *coordinator = nullptr){
+    const int n = (int)genomes.size();
+    std::vector<neat::Phenotype> nets(n);
+    pool.parallelFor(n, [&](int i, int){ nets[i] = neat::Phenotype(genomes[i], INFERENCE_PRECISION); });
+
+    EvaluationStats stats;
+    stats.fixedBudget = (long long)n * NUM_GAMES_PER_EVAL * MAX_PIECES;
+    std::vector<std::vector<int>> lines(n);
+    std::vector<double> mean(n, 0.0);
+    std::vector<int> alive(n);
+    for(int i=0; i<n; ++i) alive[i] = i;
+    int roundGames = RACING_EVALUATION ? std::min(2, RACE_MAX_GAMES) : NUM_GAMES_PER_EVAL;
+
+    std::vector<uint64_t> hashes(n);
+    for(int i=0; i<n; ++i) hashes[i] = genomes[i].contentHash();
 
-    for(int gen=0; gen<GENERATIONS; ++gen){
+    while(!alive.empty() && roundGames > 0){
+        // This round's games in order; cached ones are filled in now, identical genomes share one task.
+        std::vector<GameResult> results(alive.size() * roundGames);
+        std::vector<int> taskOf(results.size(), -1);
+        std::vector<std::pair<int, int>> tasks; // (genome, seed) to simulate
+        std::map<std::pair<uint64_t, int>, int> firstTask;
+        for(size_t g=0; g<results.size(); ++g){
+            int i = alive[g / roundGames];
+            int seed = SEED_SCHEDULE.seed(gen, (int)lines[i].size() + (int)(g % roundGames));
+            if(!USE_FITNESS_CACHE){ taskOf[g] = (int)tasks.size(); tasks.push_back({i, seed}); continue; }
+            auto shared = firstTask.find({hashes[i], seed});
+            if(shared != firstTask.end()){ fitnessCache.countSharedHit(); taskOf[g] = shared->second; continue; }
+            if(const GameResult* cached = fitnessCache.find(hashes[i], seed, gen)){ results[g] = *cached; continue; }
+            taskOf[g] = firstTask[{hashes[i], seed}] = (int)tasks.size();
+            tasks.push_back({i, seed});
+        }
+        std::vector<GameResult> played(tasks.size());
+        std::vector<char> remote(tasks.size(), 0);
+        if(coordinator && coordinator->workers() > 0) playRemotely(genomes, tasks, played, remote, *coordinator);
+        std::vector<int> local;
+        for(size_t t=0; t<tasks.size(); ++t){
+            if(remote[t]) ++stats.remoteGames;
+            else local.push_back((int)t);
+        }
+        pool.parallelFor((int)local.size(), [&](int k, int worker){
+            int task = local[k];
+            played[task] = playGame(nets[tasks[task].first], tasks[task].second, scratch[worker]);
+        });
+        for(size_t t=0; t<tasks.size(); ++t){
+            stats.pieces += played[t].pieces;
+            if(USE_FITNESS_CACHE) fitnessCache.store(hashes[tasks[t].first], tasks[t].second, gen, played[t]);
+        }
+        for(size_t g=0; g<results.size(); ++g){
+            if(taskOf[g] >= 0) results[g] = played[taskOf[g]];
+            lines[alive[g / roundGames]].push_back(results[g].lines);
+        }
+        for(int i : alive){
+            double sum = 0; for(int l : lines[i]) sum += l;
+            mean[i] = sum / lines[i].size();
+        }
+        if(!RACING_EVALUATION) break;
+        roundGames = 1;
+
+        // Noise estimate pooled over every genome's games, and the mean a genome has to reach.
+        double squares = 0; int dof = 0;
+        for(int i=0; i<n; ++i){
+            for(int l : lines[i]) squares += (l - mean[i]) * (l - mean[i]);
+            dof += (int)lines[i].size() - 1;
+        }
+        double sigma = dof > 0 ? std::sqrt(squares / dof) : 0.0;
+        std::vector<double> ranked(mean);
+        int keep = std::max(1, (int)(n * RACE_KEEP_FRACTION));
+        std::nth_element(ranked.begin(), ranked.begin() + (keep - 1), ranked.end(), std::greater<double>());
+        double threshold = ranked[keep - 1];
+
+        std::vector<int> next;
+        for(int i : alive){
+            double ucb = mean[i] + RACE_CONFIDENCE * sigma / std::sqrt((double)lines[i].size());
+            if((int)lines[i].size() < RACE_MAX_GAMES && ucb >= threshold) next.push_back(i);
+        }
+        // Best contenders first, as many as the remaining budget can still pay full games for.
+        std::sort(next.begin(), next.end(), [&](int a, int b){ return mean[a] > mean[b]; });
+        long long affordable = (stats.fixedBudget - stats.pieces) / MAX_PIECES;
+        if((long long)next.size() > affordable) next.resize((size_t)std::max(0LL, affordable));
+        alive.swap(next);
+    }
+
+    int best = 0;
+    for(int i=0; i<n; ++i){
+        genomes[i].fitness = mean[i] * NUM_GAMES_PER_EVAL;
+        stats.games += (int)lines[i].size();
+        if(mean[i] > mean[best]) best = i;
+    }
+    stats.mostGames = n ? (int)lines[best].size() : 0;
+    fitnessCache.prune(gen, FITNESS_CACHE_MAX_AGE);
+    return stats;
+}
+
+// One island of the island model: its own population, worker threads, fitness cache and files.
+// A plain run is a single island with the historical file names.
+struct Island {
+    int id = 0;
+    neat::Population pop;
+    std::unique_ptr<ThreadPool> pool;
+    std::vector<GameScratch> scratch;
+    FitnessCache<GameResult> fitnessCache;
+    neat::MigrantMailbox inbox; // champions posted by the previous island in the ring
+    std::string stateFile, logFile, label;
+};
+
+// Island mode: whole console lines and saved_genome.txt are written under this lock.
+std::mutex islandsMutex;
+std::vector<double> islandBest; // each island's latest generation best
+
+void runIsland(Island &island, int generations, Island *next, JobCoordinator *coordinator, neat::CheckpointWriter &checkpoints){
+    neat::Population &pop = island.pop;
+    const int islands = (int)islandBest.size();
+    std::ofstream log_file(island.logFile);
+    log_file << "Generation,AverageFitness,BestFitness,BestFitnessAvgPerGame,PlacementCacheHitRate,PiecesSimulated,PieceBudget,GamesPlayed,FitnessCacheHitRate";
+#if TETRIS_PROFILE
+    // Phase times are this island's; counters are process-wide, so with islands they cover all of them.
+    log_file << ",EvaluateMs,EpochMs,SerializeMs";
+    for(int c=0; c<profile::NUM_COUNTERS; ++c) log_file << "," << profile::counterName(profile::Counter(c));
+    uint64_t counted[profile::NUM_COUNTERS];
+    for(int c=0; c<profile::NUM_COUNTERS; ++c) counted[c] = profile::total(profile::Counter(c));
+#endif
+    log_file << "\n";
+
+    for(int gen=0; gen<generations; ++gen){
         auto start_time = std::chrono::high_resolution_clock::now();
+#if TETRIS_PROFILE
+        uint64_t evaluateNs = 0, epochNs = 0, serializeNs = 0;
+#endif
 
-        if (PARALLEL_EXECUTION) {
-            std::vector<std::future<void>> futures;
-            for(auto& genome : pop.genomes) {
-                futures.push_back(std::async(std::launch::async, evaluate_genome_fitness, std::ref(genome), gen));
-            }
-            for(auto& fut : futures) { fut.get(); }
-        } else { // Serial execution for benchmarking
-            for(auto& genome : pop.genomes) {
-                evaluate_genome_fitness(genome, gen);
-            }
+        EvaluationStats evaluation;
+        {
+            PROFILE_SCOPE("evaluate", &evaluateNs);
+            evaluation = evaluate_population(pop.genomes, gen, *island.pool, island.scratch, island.fitnessCache, coordinator);
         }
         
         auto end_time = std::chrono::high_resolution_clock::now();
@@ -120,27 +355,203 @@ int main(){
         double sum = 0; double best_fitness = -1;
         for(const auto& g : pop.genomes){ sum += g.fitness; best_fitness = std::max(best_fitness, g.fitness); }
         
-        double avg_fitness = sum / POP;
-        double best_fitness_avg_per_game = best_fitness / 3.0; // New, more intuitive metric
+        double avg_fitness = sum / pop.genomes.size();
+        double best_fitness_avg_per_game = best_fitness / NUM_GAMES_PER_EVAL; // New, more intuitive metric
+        FitnessCache<GameResult>::Stats fitness_cache = island.fitnessCache.stats();
+        island.fitnessCache.resetStats();
+        // The placement cache is shared by all islands; each counts its own lookups, per generation.
+        EnumerationStats enumeration;
+        PlacementCache::Stats cache;
+        for(GameScratch &s : island.scratch){
+            enumeration.reference += s.enumeration.reference;
+            enumeration.emitted += s.enumeration.emitted;
+            cache.hits += s.placementLookups.hits;
+            cache.misses += s.placementLookups.misses;
+            s.enumeration = EnumerationStats();
+            s.placementLookups = PlacementCache::Stats();
+        }
 
-        std::cout << "Gen " << gen << " | Time: " << duration.count() << "ms | Avg Fitness: " << avg_fitness << " | Best Fitness: " << best_fitness << " (Avg/Game: " << best_fitness_avg_per_game << ")" << std::endl;
+        std::ostringstream out;
+        out << island.label << "Gen " << gen << " | Time: " << duration.count() << "ms | Avg Fitness: " << avg_fitness << " | Best Fitness: " << best_fitness << " (Avg/Game: " << best_fitness_avg_per_game << ")";
+        out << " | Pieces: " << evaluation.pieces << " of " << evaluation.fixedBudget << " budget (" << 100.0 * evaluation.pieces / evaluation.fixedBudget << "%), "
+            << evaluation.games << " games, best genome " << evaluation.mostGames;
+        if (USE_FITNESS_CACHE) out << " | Fitness cache: " << 100.0 * fitness_cache.hitRate() << "% of " << fitness_cache.hits + fitness_cache.misses << " games";
+        if (enumeration.reference) out << " | Move generation: " << enumeration.emitted << " of " << enumeration.reference << " placements kept, " << enumeration.duplicates() << " duplicate boards removed";
+        if (USE_PLACEMENT_CACHE) out << " | Placement cache: " << cache.hits << " hits / " << cache.misses << " misses (" << 100.0 * cache.hitRate() << "%)";
+        if (coordinator) out << " | Workers: " << coordinator->workers() << ", " << evaluation.remoteGames << " remote games, " << coordinator->redispatched() << " jobs re-dispatched";
+        out << "\n";
         
         // Write data to log file, including the new metric
-        log_file << gen << "," << avg_fitness << "," << best_fitness << "," << best_fitness_avg_per_game << "\n";
+        log_file << gen << "," << avg_fitness << "," << best_fitness << "," << best_fitness_avg_per_game << "," << cache.hitRate() << "," << evaluation.pieces << "," << evaluation.fixedBudget << "," << evaluation.games << "," << fitness_cache.hitRate();
         
         std::sort(pop.genomes.begin(), pop.genomes.end(), [](const neat::Genome& a, const neat::Genome& b){ return a.fitness > b.fitness; });
         
-        std::ofstream best_out("saved_genome.txt");
-        std::stringstream ss;
-        pop.genomes[0].serialize(ss);
-        best_out << ss.str();
-        best_out.close();
-
-        pop.epoch(4);
-        pop.serialize(POP_STATE_FILE);
+        {   // saved_genome.txt holds the best genome of the latest generations across islands
+            std::lock_guard<std::mutex> lock(islandsMutex);
+            islandBest[island.id] = best_fitness;
+            if(best_fitness >= *std::max_element(islandBest.begin(), islandBest.end())){
+                PROFILE_SCOPE("serialize", &serializeNs);
+                std::stringstream ss;
+                pop.genomes[0].serialize(ss);
+                checkpoints.write("saved_genome.txt", ss.str());
+            }
+        }
+        if(next && (gen + 1) % MIGRATION_INTERVAL == 0){
+            size_t count = std::min<size_t>(MIGRANTS, pop.genomes.size());
+            next->inbox.post(std::vector<neat::Genome>(pop.genomes.begin(), pop.genomes.begin() + count));
+        }
+
+        // Migrants replace this generation's lowest-fitness genomes and keep the fitness they earned
+        // at home, so epoch() ranks, speciates and breeds them like natives.
+        if(std::unique_ptr<std::vector<neat::Genome>> migrants = island.inbox.take()){
+            for(size_t m=0; m<migrants->size() && m<pop.genomes.size(); ++m) pop.genomes[pop.genomes.size() - 1 - m] = (*migrants)[m];
+        }
+        {
+            PROFILE_SCOPE("epoch", &epochNs);
+            pop.epoch(4);
+        }
+        out << "    " << island.label << pop.numSpecies() << " species (compatibility threshold " << pop.compatThreshold << ")\n";
+        {
+            std::lock_guard<std::mutex> lock(islandsMutex);
+            std::cout << out.str() << std::flush;
+        }
+        if((gen + 1) % CHECKPOINT_INTERVAL == 0 || gen + 1 == generations){
+            PROFILE_SCOPE("serialize", &serializeNs);
+            checkpoints.checkpoint(pop, island.stateFile);
+        }
+#if TETRIS_PROFILE
+        log_file << "," << evaluateNs / 1e6 << "," << epochNs / 1e6 << "," << serializeNs / 1e6;
+        for(int c=0; c<profile::NUM_COUNTERS; ++c){
+            uint64_t now = profile::total(profile::Counter(c));
+            log_file << "," << now - counted[c];
+            counted[c] = now;
+        }
+#endif
+        log_file << "\n";
+        std::string checkpoint_error = checkpoints.takeError();
+        if(!checkpoint_error.empty()) std::cerr << checkpoint_error << std::endl;
+    }
+}
+
+// Usage: train                    train on this machine
+//        train --listen [ADDR:]PORT  train, sending games to any workers that connect
+//        train --worker HOST:PORT    play games for a trainer until it finishes
+//        train --islands K           evolve K populations on their own threads (combines with --listen)
+int main(int argc, char** argv){
+    std::string listenEndpoint, workerEndpoint;
+    int islands = ISLANDS;
+    for(int i=1; i+1<argc; i+=2){
+        std::string flag = argv[i];
+        if(flag == "--listen") listenEndpoint = argv[i+1];
+        else if(flag == "--worker") workerEndpoint = argv[i+1];
+        else if(flag == "--islands") islands = std::atoi(argv[i+1]);
+        else islands = 0;
+    }
+    if(argc % 2 == 0 || islands < 1 || islands > INT_MAX / neat::ISLAND_ID_SPACE){
+        std::cerr << "usage: " << argv[0] << " [--listen [ADDR:]PORT | --worker HOST:PORT] [--islands K], 1 <= K <= " << INT_MAX / neat::ISLAND_ID_SPACE << std::endl;
+        return 1;
+    }
+    const int cores = PARALLEL_EXECUTION ? (int)std::thread::hardware_concurrency() : 1;
+
+    if(!workerEndpoint.empty()){
+        ThreadPool pool(cores);
+        std::vector<GameScratch> scratch(pool.size());
+        std::string host, error;
+        uint16_t port;
+        if(!splitEndpoint(workerEndpoint, host, port)){ std::cerr << "bad endpoint " << workerEndpoint << std::endl; return 1; }
+        std::cout << "Worker playing games for " << workerEndpoint << " on " << pool.size() << " thread(s)." << std::endl;
+        auto handler = [&](const std::string &job){ return playJob(job, pool, scratch); };
+        if(!serveJobs(host, port, "train worker, " + std::to_string(pool.size()) + " threads", handler, &error)){
+            std::cerr << error << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    std::unique_ptr<JobCoordinator> coordinator;
+    if(!listenEndpoint.empty()){
+        std::string address = LISTEN_ADDRESS;
+        uint16_t port;
+        bool ok = listenEndpoint.find(':') == std::string::npos ? splitEndpoint(address + ":" + listenEndpoint, address, port)
+                                                                : splitEndpoint(listenEndpoint, address, port);
+        if(!ok){ std::cerr << "bad endpoint " << listenEndpoint << std::endl; return 1; }
+        coordinator.reset(new JobCoordinator(address, port));
+        if(!coordinator->listening()){ std::cerr << coordinator->error() << std::endl; return 1; }
+        std::cout << "Listening for workers on " << address << ":" << port << std::endl;
+    }
+
+    const int POP = 100;
+    const int INPUTS = 4;
+    const int OUTPUTS = 1;
+    const std::string POP_STATE_FILE = "population_state.ckpt";
+    const std::string LEGACY_POP_STATE_FILE = "population_state.txt"; // text state from older builds
+    const int GENERATIONS = 50;
+
+    std::vector<std::unique_ptr<Island>> ring;
+    islandBest.assign(islands, -1.0);
+    for(int k=0; k<islands; ++k){
+        ring.emplace_back(new Island);
+        Island &island = *ring.back();
+        island.id = k;
+        std::string suffix = islands == 1 ? "" : ".island" + std::to_string(k);
+        island.stateFile = "population_state" + suffix + ".ckpt";
+        island.logFile = "training_log" + suffix + ".csv";
+        island.label = islands == 1 ? "" : "[island " + std::to_string(k) + "] ";
+
+        neat::Population &pop = island.pop;
+        std::string checkpoint_error;
+        std::ifstream legacy_in(islands == 1 ? LEGACY_POP_STATE_FILE : std::string());
+        if(std::ifstream(island.stateFile)) {
+            // A checkpoint that is there but does not load is never replaced by a fresh run.
+            if(!neat::loadCheckpoint(island.stateFile, pop, &checkpoint_error)) {
+                std::cerr << checkpoint_error << std::endl;
+                std::cerr << island.stateFile << " exists but cannot be loaded; move it aside to start a new session." << std::endl;
+                return 1;
+            }
+            std::cout << "Resuming training from " << island.stateFile << std::endl;
+        } else if(legacy_in.is_open()) {
+            std::cout << "Resuming training from " << LEGACY_POP_STATE_FILE << std::endl;
+            pop = neat::Population::deserialize(LEGACY_POP_STATE_FILE);
+        } else {
+            std::cout << island.label << "Starting new training session." << std::endl;
+            pop = neat::Population(POP, INPUTS, OUTPUTS, (int)std::chrono::system_clock::now().time_since_epoch().count() + k);
+        }
+        if(islands > 1){
+            neat::claimIdSpace(pop, k);
+            const MutationRates &rates = ISLAND_MUTATION_RATES[k % (sizeof ISLAND_MUTATION_RATES / sizeof ISLAND_MUTATION_RATES[0])];
+            pop.weightStep = rates.weightStep;
+            pop.addNodeRate = rates.addNode;
+            pop.addLinkRate = rates.addLink;
+        }
+
+        // Cores are split evenly between islands.
+        island.pool.reset(new ThreadPool(std::max(1, cores / islands)));
+        island.scratch.resize(island.pool->size());
+        ThreadPool &pool = *island.pool;
+        pop.parallelFor = [&pool](int n, const std::function<void(int)> &body){ pool.parallelFor(n, [&body](int i, int){ body(i); }); };
+        std::cout << island.label << "Evaluating on " << pool.size() << " worker thread(s)";
+        if(islands > 1) std::cout << ", weight step " << pop.weightStep << ", add node " << pop.addNodeRate << ", add link " << pop.addLinkRate;
+        std::cout << "." << std::endl;
+    }
+
+    neat::CheckpointWriter checkpoints(CHECKPOINT_QUEUE_DEPTH * islands); // writes off the critical path; drained on exit
+
+    if(islands == 1){
+        runIsland(*ring[0], GENERATIONS, nullptr, coordinator.get(), checkpoints);
+    } else {
+        std::vector<std::thread> threads;
+        for(int k=0; k<islands; ++k)
+            threads.emplace_back(runIsland, std::ref(*ring[k]), GENERATIONS, ring[(k + 1) % islands].get(), coordinator.get(), std::ref(checkpoints));
+        for(auto &t : threads) t.join();
     }
     
-    log_file.close();
-    std::cout << "Training finished. Log saved to training_log.csv" << std::endl;
+    checkpoints.flush();
+#if TETRIS_PROFILE
+    std::string trace_error;
+    if(profile::writeChromeTrace(TRACE_FILE, &trace_error)) std::cout << "Profile trace saved to " << TRACE_FILE << std::endl;
+    else std::cerr << trace_error << std::endl;
+#endif
+    std::cout << "Checkpoint writer: " << checkpoints.filesWritten() << " files written, " << checkpoints.backpressureWaits() << " waits for a free slot" << std::endl;
+    std::cout << "Training finished. Log saved to " << (islands == 1 ? "training_log.csv" : "training_log.island*.csv") << std::endl;
     return 0;
-}
\ No newline at end of file
+}
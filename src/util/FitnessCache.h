@@ -0,0 +1,59 @@
+#pragma once
+#include <cstdint>
+#include <unordered_map>
+
+// Results of finished games keyed by (genome content hash, seed). Only valid while the game
+// rules and the inference precision stay the same, i.e. within one training run. Not
+// thread-safe: the evaluator looks up and stores results between pool batches.
+template <class Result>
+class FitnessCache {
+public:
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        double hitRate() const { return hits + misses ? double(hits) / double(hits + misses) : 0.0; }
+    };
+
+    const Result* find(uint64_t genome, int seed, int generation) {
+        auto it = entries.find(key(genome, seed));
+        if(it == entries.end() || it->second.genome != genome || it->second.seed != seed){
+            ++counters.misses;
+            return nullptr;
+        }
+        ++counters.hits;
+        it->second.lastUsed = generation;
+        return &it->second.result;
+    }
+
+    // Counts a result shared with an identical genome simulated in the same batch.
+    void countSharedHit() { ++counters.hits; }
+
+    void store(uint64_t genome, int seed, int generation, const Result& result) {
+        entries[key(genome, seed)] = Entry{genome, seed, generation, result};
+    }
+
+    // Forgets results nobody has used for more than `maxAge` generations.
+    void prune(int generation, int maxAge) {
+        for(auto it = entries.begin(); it != entries.end();){
+            if(generation - it->second.lastUsed > maxAge) it = entries.erase(it);
+            else ++it;
+        }
+    }
+
+    Stats stats() const { return counters; }
+    void resetStats() { counters = Stats(); }
+    size_t size() const { return entries.size(); }
+
+private:
+    struct Entry {
+        uint64_t genome;
+        int seed;
+        int lastUsed;
+        Result result;
+    };
+    static uint64_t key(uint64_t genome, int seed) {
+        return genome ^ (0x9E3779B97F4A7C15ull * (uint64_t(uint32_t(seed)) + 1));
+    }
+    std::unordered_map<uint64_t, Entry> entries;
+    Stats counters;
+};
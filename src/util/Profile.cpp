@@ -0,0 +1,125 @@
+#include "Profile.h"
+
+const char* profile::counterName(Counter c) {
+    switch(c){
+    case PlacementsGenerated: return "PlacementsGenerated";
+    case NetworkEvaluations: return "NetworkEvaluations";
+    case PiecesSimulated: return "PiecesSimulated";
+    case GamesAborted: return "GamesAborted";
+    case NUM_COUNTERS: break;
+    }
+    return "?";
+}
+
+#if TETRIS_PROFILE
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace {
+    const size_t MAX_EVENTS_PER_THREAD = 1 << 20; // later scopes are counted as dropped
+
+    struct Event {
+        const char* name;
+        uint64_t start, end;
+    };
+
+    // One per thread, owned by the registry so it outlives its thread. Only the owner writes;
+    // counters are atomics so total() can read them from another thread at any time.
+    struct ThreadLog {
+        int tid = 0;
+        std::atomic<uint64_t> counters[profile::NUM_COUNTERS] = {};
+        std::mutex mutex; // events: taken by the owner per scope, uncontended except while dumping
+        std::vector<Event> events;
+        uint64_t dropped = 0;
+    };
+
+    std::mutex registryMutex;
+    std::vector<std::unique_ptr<ThreadLog>>& registry() {
+        static std::vector<std::unique_ptr<ThreadLog>> logs;
+        return logs;
+    }
+
+    ThreadLog& threadLog() {
+        thread_local ThreadLog* log = nullptr;
+        if(!log){
+            std::lock_guard<std::mutex> lock(registryMutex);
+            registry().emplace_back(new ThreadLog);
+            log = registry().back().get();
+            log->tid = (int)registry().size();
+        }
+        return *log;
+    }
+
+    const std::chrono::steady_clock::time_point& epoch() {
+        static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        return start;
+    }
+}
+
+uint64_t profile::nowNs() {
+    const auto& start = epoch();
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+void profile::count(Counter c, uint64_t n) {
+    std::atomic<uint64_t>& v = threadLog().counters[c];
+    v.store(v.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+void profile::record(const char* name, uint64_t startNs, uint64_t endNs) {
+    ThreadLog& log = threadLog();
+    std::lock_guard<std::mutex> lock(log.mutex);
+    if(log.events.size() < MAX_EVENTS_PER_THREAD) log.events.push_back({name, startNs, endNs});
+    else ++log.dropped;
+}
+
+uint64_t profile::total(Counter c) {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    uint64_t sum = 0;
+    for(const auto& log : registry()) sum += log->counters[c].load(std::memory_order_relaxed);
+    return sum;
+}
+
+// Chrome trace event format: complete ("X") events in microseconds, one tid per thread, and the
+// final counter totals as metadata.
+bool profile::writeChromeTrace(const std::string& path, std::string* error) {
+    std::ofstream out(path);
+    if(!out){
+        if(error) *error = "cannot open " + path;
+        return false;
+    }
+    out << std::fixed << std::setprecision(3) << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    uint64_t dropped = 0;
+    std::lock_guard<std::mutex> registryLock(registryMutex);
+    for(const auto& log : registry()){
+        std::lock_guard<std::mutex> lock(log->mutex);
+        dropped += log->dropped;
+        for(const Event& e : log->events){
+            out << (first ? "\n" : ",\n") << "{\"name\":\"" << e.name << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << log->tid
+                << ",\"ts\":" << e.start / 1000.0 << ",\"dur\":" << (e.end - e.start) / 1000.0 << "}";
+            first = false;
+        }
+    }
+    out << "\n],\"otherData\":{\"droppedEvents\":" << dropped;
+    for(int c=0; c<NUM_COUNTERS; ++c){
+        uint64_t sum = 0;
+        for(const auto& log : registry()) sum += log->counters[c].load(std::memory_order_relaxed);
+        out << ",\"" << counterName(Counter(c)) << "\":" << sum;
+    }
+    out << "}}\n";
+    out.close();
+    if(!out){
+        if(error) *error = "error writing " + path;
+        return false;
+    }
+    return true;
+}
+
+#endif
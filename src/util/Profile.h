@@ -0,0 +1,65 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+// Hot-path instrumentation, compiled in with -DTETRIS_PROFILE=ON. Scoped timers record one
+// complete event per scope into a per-thread buffer (dumped as Chrome trace JSON, viewable in
+// chrome://tracing or Perfetto); counters are per-thread too, so the hot path never shares a
+// cache line. Without TETRIS_PROFILE the macros expand to nothing and their arguments are never
+// evaluated, so instrumented code costs exactly what it did before.
+//
+//   PROFILE_SCOPE("epoch");               times the rest of the enclosing block
+//   PROFILE_SCOPE("epoch", &epochNs);     ... and adds its duration to a uint64_t
+//   PROFILE_COUNT(PiecesSimulated, n);    adds n to a process-wide counter
+
+namespace profile {
+    enum Counter {
+        PlacementsGenerated, // candidates listed by move generation (not by placement cache hits)
+        NetworkEvaluations,  // candidates scored by a network
+        PiecesSimulated,
+        GamesAborted,        // games ended by Board::isGameOver before the piece limit
+        NUM_COUNTERS
+    };
+
+    const char* counterName(Counter c);
+}
+
+#if TETRIS_PROFILE
+
+namespace profile {
+    uint64_t nowNs(); // since the first profiler call in the process
+    void count(Counter c, uint64_t n);
+    void record(const char* name, uint64_t startNs, uint64_t endNs);
+    // Sum over every thread that ever counted.
+    uint64_t total(Counter c);
+    // Writes every recorded scope, with each thread's events on its own track.
+    bool writeChromeTrace(const std::string& path, std::string* error = nullptr);
+
+    class Scope {
+    public:
+        explicit Scope(const char* name, uint64_t* totalNs = nullptr): name(name), totalNs(totalNs), start(nowNs()) {}
+        ~Scope() {
+            uint64_t end = nowNs();
+            record(name, start, end);
+            if(totalNs) *totalNs += end - start;
+        }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    private:
+        const char* name;
+        uint64_t* totalNs;
+        uint64_t start;
+    };
+}
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(...) profile::Scope PROFILE_CONCAT(profileScope_, __LINE__)(__VA_ARGS__)
+#define PROFILE_COUNT(counter, n) profile::count(profile::counter, (uint64_t)(n))
+
+#else
+
+#define PROFILE_SCOPE(...)
+#define PROFILE_COUNT(counter, n)
+
+#endif
@@ -0,0 +1,34 @@
+#pragma once
+
+// Which game seed evaluation game `game` of generation `generation` uses. Every genome of a
+// generation plays the same seeds, so results can be shared between identical genomes, and a
+// schedule that repeats seeds across generations lets unchanged genomes reuse earlier games.
+class SeedSchedule {
+public:
+    enum class Kind {
+        Fixed,         // one benchmark set: seed base + game, every generation
+        Rotating,      // a window of seeds that slides by `stride` each generation
+        PerGeneration, // fresh seeds every generation (the original gen*10000 + game)
+    };
+
+    static SeedSchedule fixed(int base = 1000) { return SeedSchedule(Kind::Fixed, base, 0); }
+    static SeedSchedule rotating(int base = 1000, int stride = 1) { return SeedSchedule(Kind::Rotating, base, stride); }
+    static SeedSchedule perGeneration() { return SeedSchedule(Kind::PerGeneration, 0, 10000); }
+
+    int seed(int generation, int game) const {
+        switch(kind){
+        case Kind::Fixed: return base + game;
+        case Kind::Rotating: return base + generation * stride + game;
+        case Kind::PerGeneration: break;
+        }
+        return generation * stride + game;
+    }
+
+    Kind type() const { return kind; }
+
+private:
+    SeedSchedule(Kind kind, int base, int stride): kind(kind), base(base), stride(stride) {}
+    Kind kind;
+    int base;
+    int stride;
+};
@@ -0,0 +1,89 @@
+#include "ThreadPool.h"
+#include <algorithm>
+
+void ThreadPool::Batch::wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [this]{ return done(); });
+}
+
+ThreadPool::ThreadPool(int threads) {
+    threads = std::max(threads, 1);
+    for(int i=0; i<threads; ++i) queues.push_back(std::make_unique<Queue>());
+    for(int i=0; i<threads; ++i) workers.emplace_back([this, i]{ run(i); });
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for(auto& t : workers) t.join();
+}
+
+std::shared_ptr<ThreadPool::Batch> ThreadPool::submit(int n, Body body) {
+    auto batch = std::make_shared<Batch>();
+    batch->body = std::move(body);
+    batch->remaining.store(std::max(n, 0), std::memory_order_relaxed);
+    if(n <= 0) return batch;
+
+    {   // counted before any task is visible, so a worker never takes more than was announced
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        queued.fetch_add(n, std::memory_order_release);
+    }
+    int w = size();
+    for(int q=0; q<w; ++q){
+        int begin = (int)((long long)n * q / w), end = (int)((long long)n * (q + 1) / w);
+        if(begin == end) continue;
+        std::lock_guard<std::mutex> lock(queues[q]->mutex);
+        for(int i=end-1; i>=begin; --i) queues[q]->tasks.push_back({batch, i}); // back = lowest index
+    }
+    wake.notify_all();
+    return batch;
+}
+
+void ThreadPool::parallelFor(int n, Body body) {
+    submit(n, std::move(body))->wait();
+}
+
+bool ThreadPool::take(int worker, Task& task) {
+    {
+        Queue& own = *queues[worker];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if(!own.tasks.empty()){
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+    for(int k=1; k<size(); ++k){
+        Queue& victim = *queues[(worker + k) % size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if(!victim.tasks.empty()){
+            task = std::move(victim.tasks.front()); // the victim's last-in-line work
+            victim.tasks.pop_front();
+            stolen.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::run(int worker) {
+    for(;;){
+        Task task;
+        if(!take(worker, task)){
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            wake.wait(lock, [this]{ return stopping || queued.load(std::memory_order_acquire) > 0; });
+            if(stopping && queued.load(std::memory_order_acquire) == 0) return;
+            continue;
+        }
+        queued.fetch_sub(1, std::memory_order_acq_rel);
+        task.batch->body(task.index, worker);
+        if(task.batch->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1){
+            // task.batch keeps the batch alive even if the submitter drops its handle once notified
+            { std::lock_guard<std::mutex> lock(task.batch->mutex); }
+            task.batch->finished.notify_all();
+        }
+    }
+}
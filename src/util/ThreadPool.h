@@ -0,0 +1,66 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads with one task deque each. A batch of n tasks is split into
+// contiguous blocks, one per worker; a worker takes its own tasks from the back and, once they
+// run out, steals from the front of the others, so one slow task never idles the rest.
+// Tasks get the index of the worker running them, for per-thread scratch.
+class ThreadPool {
+public:
+    using Body = std::function<void(int index, int worker)>;
+
+    // Handle to a submitted batch.
+    class Batch {
+    public:
+        bool done() const { return remaining.load(std::memory_order_acquire) == 0; }
+        void wait();
+    private:
+        friend class ThreadPool;
+        Body body;
+        std::atomic<int> remaining{0};
+        std::mutex mutex;
+        std::condition_variable finished;
+    };
+
+    explicit ThreadPool(int threads = (int)std::thread::hardware_concurrency());
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int size() const { return (int)queues.size(); } // fixed before any worker starts
+
+    // Queues body(i, worker) for every i in [0, n) and returns immediately.
+    std::shared_ptr<Batch> submit(int n, Body body);
+    // submit() and wait for the batch.
+    void parallelFor(int n, Body body);
+
+    uint64_t steals() const { return stolen.load(std::memory_order_relaxed); }
+
+private:
+    struct Task {
+        std::shared_ptr<Batch> batch; // keeps the batch alive until its last task has notified
+        int index;
+    };
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    std::atomic<int> queued{0};
+    std::atomic<uint64_t> stolen{0};
+    bool stopping = false;
+
+    bool take(int worker, Task& task);
+    void run(int worker);
+};
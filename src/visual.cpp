@@ -4,25 +4,11 @@
 #include <string>
 #include <sstream>
 #include <algorithm>
+#include "game/Bag.h"
 #include "game/Board.h"
 #include "game/Tetrimino.h"
 #include "neat/NEAT.h"
-
-class Bag {
-    std::vector<TetrominoType> bag;
-    std::mt19937 rng;
-public:
-    Bag(int seed=123): rng(seed) { refill(); }
-    void refill(){
-        bag = {TetrominoType::I, TetrominoType::O, TetrominoType::T, TetrominoType::L, TetrominoType::J, TetrominoType::S, TetrominoType::Z};
-        std::shuffle(bag.begin(), bag.end(), rng);
-    }
-    TetrominoType next(){
-        if(bag.empty()) refill();
-        TetrominoType t = bag.back(); bag.pop_back();
-        return t;
-    }
-};
+#include "render/PieceColor.h"
 
 neat::Genome deserialize_genome_from_string(const std::string& s) {
     neat::Genome g;
@@ -47,11 +33,10 @@ void drawBlock(sf::RenderWindow& window, float x, float y, float size, const sf:
 }
 
 void drawTetrimino(sf::RenderWindow& window, const Tetromino& tet, int rot, float px, float py, float baseX, float baseY, float CELL_SIZE) {
-    const int* s = tet.state(rot);
     for(int by = 0; by < 4; ++by) {
         for(int bx = 0; bx < 4; ++bx) {
-            if(s[by * 4 + bx]) {
-                drawBlock(window, baseX + (px + bx) * CELL_SIZE, baseY + (py + by) * CELL_SIZE, CELL_SIZE -1, tet.color);
+            if(tet.cell(rot, bx, by)) {
+                drawBlock(window, baseX + (px + bx) * CELL_SIZE, baseY + (py + by) * CELL_SIZE, CELL_SIZE -1, pieceColor(tet.type));
             }
         }
     }
@@ -63,6 +48,7 @@ int main(){
     std::string content((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
     in.close();
     neat::Genome g = deserialize_genome_from_string(content);
+    neat::Phenotype net(g);
 
     const float CELL_SIZE = 25.f, BORDER = 20.f, UI_W = 200.f;
     sf::RenderWindow window(sf::VideoMode(Board::WIDTH*CELL_SIZE+UI_W+2*BORDER, Board::HEIGHT*CELL_SIZE+2*BORDER), "Tetris NEAT Demo");
@@ -74,6 +60,8 @@ int main(){
     long score = 0; int totalLines = 0, level = 1;
     float speed = 1.0f;
     Board board;
+    PlacementBuffer placements;
+    neat::Activations activations;
 
     while(window.isOpen()){
         sf::Event ev;
@@ -89,16 +77,10 @@ int main(){
             board.clear(); score = 0; totalLines = 0; level = 1;
         }
 
-        auto placements = board.allPossiblePlacements(current);
+        board.canonicalPlacements(current, placements);
         if(placements.empty()){ board.clear(); continue; }
         
-        double bestScore = -1e9; int bestIdx = -1;
-        for(size_t i=0; i<placements.size(); ++i){
-            auto &p = placements[i];
-            std::vector<double> inputs = { (double)p.aggregateHeight/400.0, (double)p.holes/400.0, (double)p.bumpiness/400.0, (double)p.clearedLines/4.0 };
-            double scoreVal = g.evaluate(inputs);
-            if(scoreVal > bestScore){ bestScore = scoreVal; bestIdx = i; }
-        }
+        int bestIdx = net.argmax(placements.featureColumns().data(), PlacementBuffer::NUM_FEATURES, placements.size(), activations);
         
         if(bestIdx < 0) { board.clear(); continue; }
 
@@ -117,9 +99,8 @@ int main(){
                 window.draw(cell);
             }
             
-            const auto& cells = board.cells();
             for(int y=0;y<Board::HEIGHT;++y) for(int x=0;x<Board::WIDTH;++x){
-                if(cells[y*Board::WIDTH + x]) {
+                if(board.isCell(x, y)) {
                    drawBlock(window, BORDER + x*CELL_SIZE, BORDER + y*CELL_SIZE, CELL_SIZE-1, sf::Color(128,128,128));
                 }
             }
@@ -4,33 +4,32 @@
 #include <random>
 #include <chrono>
 #include <thread>
-#include <future>
+#include <functional>
 #include <string>
 #include <sstream>
 #include <algorithm>
+#include "game/Bag.h"
 #include "game/Board.h"
 #include "game/Tetrimino.h"
+#include "neat/Checkpoint.h"
+#include "neat/CheckpointWriter.h"
 #include "neat/NEAT.h"
+#include "render/PieceColor.h"
+#include "util/ThreadPool.h"
 
-class Bag {
-    std::vector<TetrominoType> bag;
-    std::mt19937 rng;
-public:
-    Bag(int seed=123): rng(seed) { refill(); }
-    void refill(){
-        bag = {TetrominoType::I, TetrominoType::O, TetrominoType::T, TetrominoType::L, TetrominoType::J, TetrominoType::S, TetrominoType::Z};
-        std::shuffle(bag.begin(), bag.end(), rng);
-    }
-    TetrominoType next(){
-        if(bag.empty()) refill();
-        TetrominoType t = bag.back(); bag.pop_back();
-        return t;
-    }
+// Buffers one pool worker reuses for every game it plays.
+struct GameScratch {
+    Board board;
+    PlacementBuffer placements;
+    neat::Activations activations;
 };
 
-int linesClearedInGame(const neat::Genome &g, int seed){
-    Board b;
+int linesClearedInGame(const neat::Phenotype &net, int seed, GameScratch &scratch){
+    Board &b = scratch.board;
+    PlacementBuffer &placements = scratch.placements;
+    b.clear();
     Bag bag(seed);
+    GarbageHoles holes(seed);
     int totalLines = 0;
     int pieceCount = 0;
     const int maxPieces = 500;
@@ -39,24 +38,17 @@ int linesClearedInGame(const neat::Genome &g, int seed){
     auto makeTet = [](TetrominoType t){ return Tetromino(t); };
     while(pieceCount < maxPieces){
         Tetromino tet(makeTet(bag.next()));
-        auto placements = b.allPossiblePlacements(tet);
+        b.canonicalPlacements(tet, placements);
         if(placements.empty()) break;
-        double bestScore = -1e9;
-        int bestIdx = -1;
-        for(size_t i=0;i<placements.size();++i){
-            auto &p = placements[i];
-            std::vector<double> inputs = { (double)p.aggregateHeight/400.0, (double)p.holes/400.0, (double)p.bumpiness/400.0, (double)p.clearedLines/4.0 };
-            double score = g.evaluate(inputs);
-            if(score > bestScore){ bestScore = score; bestIdx = i; }
-        }
+        int bestIdx = net.argmax(placements.featureColumns().data(), PlacementBuffer::NUM_FEATURES, placements.size(), scratch.activations);
         if(bestIdx<0) break;
         
         b.applyPlacement(placements[bestIdx], tet);
-        totalLines += placements[bestIdx].clearedLines;
+        totalLines += placements.clearedLines[bestIdx];
         pieceCount++;
 
         if (pieceCount > 0 && pieceCount % garbageFrequency == 0) {
-            b.addGarbageLine();
+            b.addGarbageLine(holes.next(Board::WIDTH));
         }
 
         if(b.isGameOver()) break;
@@ -64,19 +56,25 @@ int linesClearedInGame(const neat::Genome &g, int seed){
     return totalLines;
 }
 
-void evaluate_genome_fitness(neat::Genome &g, int gen){
-    int fitness = 0;
-    for(int s=0; s<3; ++s){
-        fitness += linesClearedInGame(g, gen*10000 + g.nodes[0].id * 10 + s);
-    }
-    g.fitness = fitness;
+const int NUM_GAMES_PER_EVAL = 3;
+
+// Queues one pool task per game, (genome, seed); returns at once so the window stays responsive.
+// `nets` and `lines` must outlive the batch.
+std::shared_ptr<ThreadPool::Batch> start_evaluation(std::vector<neat::Genome> &genomes, int gen, ThreadPool &pool, std::vector<GameScratch> &scratch,
+                                                    std::vector<neat::Phenotype> &nets, std::vector<int> &lines){
+    nets.assign(genomes.size(), neat::Phenotype());
+    for(size_t i=0; i<genomes.size(); ++i) nets[i] = neat::Phenotype(genomes[i]);
+    lines.assign(genomes.size() * NUM_GAMES_PER_EVAL, 0);
+    return pool.submit((int)lines.size(), [&genomes, &scratch, &nets, &lines, gen](int task, int worker){
+        int i = task / NUM_GAMES_PER_EVAL, s = task % NUM_GAMES_PER_EVAL;
+        lines[task] = linesClearedInGame(nets[i], gen*10000 + genomes[i].nodes[0].id * 10 + s, scratch[worker]);
+    });
 }
 
 void drawTetriminoVis(sf::RenderWindow& window, const Tetromino& tet, int rot, float px, float py, float baseX, float baseY, float CELL_SIZE, sf::Color color) {
-    const int* s = tet.state(rot);
     for(int by = 0; by < 4; ++by) {
         for(int bx = 0; bx < 4; ++bx) {
-            if(s[by * 4 + bx]) {
+            if(tet.cell(rot, bx, by)) {
                 sf::RectangleShape r(sf::Vector2f(CELL_SIZE - 1, CELL_SIZE - 1));
                 r.setPosition(baseX + (px + bx) * CELL_SIZE, baseY + (py + by) * CELL_SIZE);
                 r.setFillColor(color);
@@ -92,6 +90,9 @@ void visualizeGame(sf::RenderWindow& window, const neat::Genome& g, sf::Font& fo
     Bag bag(12345);
     int totalLines = 0;
     Tetromino current = Tetromino(bag.next());
+    neat::Phenotype net(g);
+    PlacementBuffer placements;
+    neat::Activations activations;
     
     while(window.isOpen() && !board.isGameOver()) {
         sf::Event ev;
@@ -99,20 +100,13 @@ void visualizeGame(sf::RenderWindow& window, const neat::Genome& g, sf::Font& fo
             if(ev.type==sf::Event::Closed) window.close();
         }
 
-        auto placements = board.allPossiblePlacements(current);
+        board.canonicalPlacements(current, placements);
         if(placements.empty()) break;
 
-        double bestScore = -1e9;
-        int bestIdx = -1;
-        for(size_t i=0;i<placements.size();++i){
-            auto &p = placements[i];
-            std::vector<double> inputs = { (double)p.aggregateHeight/400.0, (double)p.holes/400.0, (double)p.bumpiness/400.0, (double)p.clearedLines/4.0 };
-            double score = g.evaluate(inputs);
-            if(score > bestScore){ bestScore = score; bestIdx = i; }
-        }
+        int bestIdx = net.argmax(placements.featureColumns().data(), PlacementBuffer::NUM_FEATURES, placements.size(), activations);
 
         if (bestIdx >= 0) {
-            Placement& chosen = placements[bestIdx];
+            Placement chosen = placements[bestIdx];
             
             window.clear(sf::Color(30, 30, 40));
             
@@ -123,9 +117,8 @@ void visualizeGame(sf::RenderWindow& window, const neat::Genome& g, sf::Font& fo
                 window.draw(cell);
             }
 
-            const auto& cells = board.cells();
             for(int y=0;y<Board::HEIGHT;++y) for(int x=0;x<Board::WIDTH;++x){
-                 if(cells[y*Board::WIDTH + x]) {
+                 if(board.isCell(x, y)) {
                     sf::RectangleShape r(sf::Vector2f(CELL_SIZE-1, CELL_SIZE-1));
                     r.setPosition(BORDER + x * CELL_SIZE, BORDER + y * CELL_SIZE);
                     r.setFillColor(sf::Color(100,100,100));
@@ -133,10 +126,11 @@ void visualizeGame(sf::RenderWindow& window, const neat::Genome& g, sf::Font& fo
                  }
             }
 
-            for(const auto& p : placements) {
-                drawTetriminoVis(window, current, p.rotation, p.x, p.y, BORDER, BORDER, CELL_SIZE, sf::Color(current.color.r, current.color.g, current.color.b, 30));
+            const sf::Color color = pieceColor(current.type);
+            for(int i=0; i<placements.size(); ++i) {
+                drawTetriminoVis(window, current, placements.rotation[i], placements.x[i], placements.y[i], BORDER, BORDER, CELL_SIZE, sf::Color(color.r, color.g, color.b, 30));
             }
-            drawTetriminoVis(window, current, chosen.rotation, chosen.x, chosen.y, BORDER, BORDER, CELL_SIZE, current.color);
+            drawTetriminoVis(window, current, chosen.rotation, chosen.x, chosen.y, BORDER, BORDER, CELL_SIZE, color);
             
             sf::Text txt;
             txt.setFont(font);
@@ -160,37 +154,43 @@ void visualizeGame(sf::RenderWindow& window, const neat::Genome& g, sf::Font& fo
 
 int main(){
     const int POP = 100, INPUTS = 4, OUTPUTS = 1;
-    const std::string POP_STATE_FILE = "population_state.txt";
+    const std::string POP_STATE_FILE = "population_state.ckpt", LEGACY_POP_STATE_FILE = "population_state.txt";
     neat::Population pop;
-    std::ifstream state_in(POP_STATE_FILE);
-    if(state_in.is_open()) { pop = neat::Population::deserialize(POP_STATE_FILE); } 
+    std::string checkpoint_error;
+    std::ifstream legacy_in(LEGACY_POP_STATE_FILE);
+    if(std::ifstream(POP_STATE_FILE)) {
+        if(!neat::loadCheckpoint(POP_STATE_FILE, pop, &checkpoint_error)) {
+            std::cerr << checkpoint_error << "\n" << POP_STATE_FILE << " exists but cannot be loaded; move it aside to start a new session." << std::endl;
+            return 1;
+        }
+        std::cout << "Resuming from " << POP_STATE_FILE << std::endl;
+    }
+    else if(legacy_in.is_open()) { pop = neat::Population::deserialize(LEGACY_POP_STATE_FILE); }
     else { pop = neat::Population(POP, INPUTS, OUTPUTS, (int)std::chrono::system_clock::now().time_since_epoch().count()); }
+    ThreadPool pool;
+    std::vector<GameScratch> scratch(pool.size());
+    std::vector<neat::Phenotype> nets;
+    std::vector<int> lines;
+    pop.parallelFor = [&pool](int n, const std::function<void(int)> &body){ pool.parallelFor(n, [&body](int i, int){ body(i); }); };
 
     const float CELL_SIZE = 20.f, BORDER = 20.f, UI_W = 200.f;
     sf::RenderWindow window(sf::VideoMode(Board::WIDTH*CELL_SIZE+UI_W+2*BORDER, Board::HEIGHT*CELL_SIZE+2*BORDER), "Tetris NEAT - Live Training");
     sf::Font font; font.loadFromFile("Arial.ttf");
 
     const int GENERATIONS = 500;
+    const int CHECKPOINT_INTERVAL = 1; // generations between population checkpoints
+    neat::CheckpointWriter checkpoints(2);
     
     for(int gen=0; gen<GENERATIONS && window.isOpen(); ++gen){
         
-        std::vector<std::future<void>> futures;
-        for(auto& genome : pop.genomes) {
-            futures.push_back(std::async(std::launch::async, evaluate_genome_fitness, std::ref(genome), gen));
-        }
+        auto evaluation = start_evaluation(pop.genomes, gen, pool, scratch, nets, lines);
 
         bool all_done = false;
         while(!all_done && window.isOpen()) {
             sf::Event ev;
             while(window.pollEvent(ev)){ if(ev.type==sf::Event::Closed) window.close(); }
 
-            all_done = true;
-            for(auto& fut : futures) {
-                if(fut.wait_for(std::chrono::milliseconds(0)) != std::future_status::ready) {
-                    all_done = false;
-                    break;
-                }
-            }
+            all_done = evaluation->done();
             
             window.clear(sf::Color(30, 30, 40));
             sf::Text waitText("Calculating Fitness...", font, 30);
@@ -198,9 +198,13 @@ int main(){
             window.draw(waitText);
             window.display();
         }
+        evaluation->wait(); // the games reference pop.genomes, so let them finish even when closing
         if(!window.isOpen()) break;
-        
-        for(auto& fut : futures) { fut.get(); }
+        for(size_t i=0; i<pop.genomes.size(); ++i){
+            int fitness = 0;
+            for(int s=0; s<NUM_GAMES_PER_EVAL; ++s) fitness += lines[i * NUM_GAMES_PER_EVAL + s];
+            pop.genomes[i].fitness = fitness;
+        }
 
         std::sort(pop.genomes.begin(), pop.genomes.end(), [](const neat::Genome& a, const neat::Genome& b){ return a.fitness > b.fitness; });
         double bestFitness = pop.genomes[0].fitness;
@@ -210,14 +214,14 @@ int main(){
 
         visualizeGame(window, pop.genomes[0], font, gen, bestFitness);
 
-        std::ofstream best_out("saved_genome.txt");
         std::stringstream ss;
         pop.genomes[0].serialize(ss);
-        best_out << ss.str();
-        best_out.close();
+        checkpoints.write("saved_genome.txt", ss.str());
 
         pop.epoch(4);
-        pop.serialize(POP_STATE_FILE);
+        if((gen + 1) % CHECKPOINT_INTERVAL == 0 || gen + 1 == GENERATIONS || !window.isOpen()) checkpoints.checkpoint(pop, POP_STATE_FILE);
+        checkpoint_error = checkpoints.takeError();
+        if(!checkpoint_error.empty()) std::cerr << checkpoint_error << std::endl;
     }
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,295 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "game/Bag.h"
+#include "game/Board.h"
+#include "game/Tetrimino.h"
+#include "neat/Checkpoint.h"
+#include "neat/NEAT.h"
+#include "util/ThreadPool.h"
+
+// Equivalence checks for the fast paths against the straightforward versions they replaced.
+// Prints every failing check and exits non-zero if there was one.
+
+int failures = 0;
+
+#define CHECK(cond, what) do { if(!(cond)){ ++failures; std::cerr << "FAIL " << __LINE__ << ": " << what << std::endl; } } while(0)
+
+// Boards from seeded games with random moves and frequent garbage, so overhangs and holes are common.
+std::vector<Board> randomBoards(int games){
+    std::vector<Board> boards;
+    PlacementBuffer placements;
+    for(int seed=0; seed<games; ++seed){
+        Board b;
+        Bag bag(seed);
+        GarbageHoles holes(seed);
+        std::mt19937 rng(seed);
+        for(int piece=1; piece<=200 && !b.isGameOver(); ++piece){
+            Tetromino tet(bag.next());
+            b.allPossiblePlacements(tet, placements);
+            if(placements.empty()) break;
+            b.applyPlacement(placements[(int)(rng() % placements.size())], tet);
+            if(piece % 5 == 0) b.addGarbageLine(holes.next(Board::WIDTH));
+            boards.push_back(b);
+        }
+    }
+    return boards;
+}
+
+// Height, holes and bumpiness recounted cell by cell.
+struct Rescan {
+    std::array<int, Board::WIDTH> heights{};
+    int aggregateHeight = 0, holes = 0, bumpiness = 0;
+};
+
+Rescan rescan(const Board &b){
+    Rescan r;
+    for(int x=0; x<Board::WIDTH; ++x){
+        int top = Board::HEIGHT;
+        for(int y=0; y<Board::HEIGHT; ++y) if(b.isCell(x, y)){ top = y; break; }
+        r.heights[x] = Board::HEIGHT - top;
+        for(int y=top; y<Board::HEIGHT; ++y) r.holes += !b.isCell(x, y);
+        r.aggregateHeight += r.heights[x];
+    }
+    for(int x=0; x+1<Board::WIDTH; ++x) r.bumpiness += std::abs(r.heights[x] - r.heights[x+1]);
+    return r;
+}
+
+// The running features after every move (line clears and garbage included) against a full
+// rescan, and on every tenth board the features evaluatePlacement predicts for each placement of
+// each piece against a rescan of the board the placement actually leads to.
+void testIncrementalFeatures(const std::vector<Board> &boards){
+    for(size_t i=0; i<boards.size(); ++i){
+        const Board &b = boards[i];
+        Rescan want = rescan(b);
+        CHECK(b.heights() == want.heights && b.aggregateHeight() == want.aggregateHeight && b.holes() == want.holes
+              && b.bumpiness() == want.bumpiness, "board " << i << ": running features differ from a rescan");
+        if(i % 10) continue;
+        PlacementBuffer placements;
+        for(int t=0; t<7; ++t){
+            Tetromino tet((TetrominoType)t);
+            b.allPossiblePlacements(tet, placements);
+            for(int k=0; k<placements.size(); ++k){
+                Board next = b;
+                next.applyPlacement(placements[k], tet);
+                Rescan after = rescan(next);
+                CHECK(placements.aggregateHeight[k] == after.aggregateHeight && placements.holes[k] == after.holes
+                      && placements.bumpiness[k] == after.bumpiness, "board " << i << " piece " << t << " placement " << k
+                      << ": evaluatePlacement differs from a rescan of the result");
+                CHECK(next.aggregateHeight() == after.aggregateHeight && next.holes() == after.holes && next.bumpiness() == after.bumpiness,
+                      "board " << i << " piece " << t << " placement " << k << ": running features differ after the move");
+            }
+        }
+    }
+}
+
+// Landing row from the skyline against the original top-down collision scan.
+void testDropRow(const std::vector<Board> &boards){
+    for(const Board &b : boards){
+        for(int t=0; t<7; ++t){
+            Tetromino tet((TetrominoType)t);
+            for(int r=0; r<tet.numStates; ++r){
+                for(int px=-tet.left(r); px + tet.right(r) < Board::WIDTH; ++px){
+                    if(b.collides(tet, r, px, -2)) continue; // rejected at spawn before any drop
+                    int scan = -4;
+                    for(int testY=-4; testY<Board::HEIGHT; ++testY){
+                        if(b.collides(tet, r, px, testY)){ scan = testY - 1; break; }
+                    }
+                    CHECK(b.dropRow(tet, r, px) == scan, "dropRow piece " << t << " rot " << r << " px " << px
+                          << ": " << b.dropRow(tet, r, px) << " != scan " << scan);
+                }
+            }
+        }
+    }
+}
+
+// Genomes grown by random splits and links, with some connections disabled; links may be
+// recurrent or self-loops, so connection order matters.
+std::vector<neat::Genome> randomGenomes(int count){
+    std::vector<neat::Genome> genomes;
+    for(int i=0; i<count; ++i){
+        neat::Population seedPop(1, PlacementBuffer::NUM_FEATURES, 1, i);
+        neat::Genome g = seedPop.genomes[0];
+        neat::StreamRng rng(99, i);
+        int innov = seedPop.globalInnov, nextNode = seedPop.nextNodeId;
+        for(int m = 0; m < i % 24; ++m){
+            g.addNode(rng, innov, nextNode);
+            g.addConnection(rng, innov);
+            g.addConnection(rng, innov);
+        }
+        g.mutateWeights(rng, 0.5, 1.5);
+        for(auto &c : g.conns) if(rng() % 7 == 0) c.enabled = false;
+        genomes.push_back(g);
+    }
+    return genomes;
+}
+
+// The compiled Phenotype against the map-based reference interpreter: bit-identical scores.
+void testPhenotype(const std::vector<neat::Genome> &genomes){
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<double> unit(-1.0, 2.0);
+    neat::Activations act;
+    for(size_t i=0; i<genomes.size(); ++i){
+        neat::Phenotype net(genomes[i]);
+        for(int trial=0; trial<50; ++trial){
+            std::vector<double> inputs(PlacementBuffer::NUM_FEATURES);
+            for(double &v : inputs) v = unit(rng);
+            double want = genomes[i].evaluate(inputs), got = net.evaluate(inputs.data(), (int)inputs.size(), act);
+            CHECK(want == got, "Phenotype::evaluate genome " << i << " trial " << trial << ": " << got << " != " << want);
+        }
+    }
+}
+
+// Batched Double scoring of whole candidate lists against one scalar evaluate() per candidate,
+// and argmax against a strict `score > best` scan.
+void testBatch(const std::vector<neat::Genome> &genomes, const std::vector<Board> &boards){
+    neat::Activations act, scalarAct;
+    PlacementBuffer placements;
+    std::vector<double> scores(PlacementBuffer::CAPACITY);
+    for(size_t i=0; i<genomes.size(); ++i){
+        neat::Phenotype net(genomes[i]);
+        for(size_t bi = i % 17; bi < boards.size(); bi += 97){
+            boards[bi].allPossiblePlacements(Tetromino((TetrominoType)(bi % 7)), placements);
+            auto cols = placements.featureColumns();
+            net.evaluateBatch(cols.data(), PlacementBuffer::NUM_FEATURES, placements.size(), scores.data(), act);
+            int best = -1; double bestScore = -1e9;
+            for(int k=0; k<placements.size(); ++k){
+                double inputs[PlacementBuffer::NUM_FEATURES];
+                for(int f=0; f<PlacementBuffer::NUM_FEATURES; ++f) inputs[f] = cols[f][k];
+                double want = net.evaluate(inputs, PlacementBuffer::NUM_FEATURES, scalarAct);
+                CHECK(scores[k] == want, "evaluateBatch genome " << i << " board " << bi << " candidate " << k << ": " << scores[k] << " != " << want);
+                if(want > bestScore){ bestScore = want; best = k; }
+            }
+            int got = net.argmax(cols.data(), PlacementBuffer::NUM_FEATURES, placements.size(), act);
+            CHECK(got == best, "argmax genome " << i << " board " << bi << ": " << got << " != " << best);
+        }
+    }
+}
+
+// The Int8 path's table sigmoid against the double one over [-4, 4], past both ends of the table.
+void testQuantizedSigmoid(){
+    const int Q = neat::Phenotype::Q_ONE;
+    double worst = 0;
+    for(int32_t x = -4 * Q; x <= 4 * Q; x += 7){
+        double got = neat::Phenotype::quantizedSigmoid(x) / double(Q), want = neat::sigmoid(x / double(Q));
+        worst = std::max(worst, std::abs(got - want));
+    }
+    CHECK(worst < 1e-4, "quantizedSigmoid is off by up to " << worst);
+    CHECK(neat::Phenotype::quantizedSigmoid(0) == Q / 2, "quantizedSigmoid(0) = " << neat::Phenotype::quantizedSigmoid(0));
+}
+
+// Reproduction is deterministic whatever parallelFor does: the same population bred serially and
+// on pools of 3 and 8 threads produces identical generations.
+void testParallelEpoch(){
+    const int generations = 8;
+    std::vector<std::vector<uint64_t>> runs;
+    for(int threads : {0, 3, 8}){
+        neat::Population pop(150, PlacementBuffer::NUM_FEATURES, 1, 31);
+        std::unique_ptr<ThreadPool> pool(threads ? new ThreadPool(threads) : nullptr);
+        if(pool) pop.parallelFor = [&pool](int n, const std::function<void(int)> &body){ pool->parallelFor(n, [&body](int i, int){ body(i); }); };
+        std::vector<uint64_t> hashes;
+        for(int gen=0; gen<generations; ++gen){
+            for(auto &g : pop.genomes) g.fitness = (double)(g.contentHash() % 1000);
+            pop.epoch(4);
+            for(const auto &g : pop.genomes) hashes.push_back(g.contentHash());
+            hashes.push_back((uint64_t)pop.globalInnov << 32 | (uint32_t)pop.nextNodeId);
+        }
+        runs.push_back(hashes);
+    }
+    CHECK(runs[1] == runs[0], "epoch on 3 threads differs from serial");
+    CHECK(runs[2] == runs[0], "epoch on 8 threads differs from serial");
+}
+
+// A saved population loads back gene for gene into a population that keeps its own pool hook.
+void testCheckpointRoundTrip(){
+    neat::Population pop(120, PlacementBuffer::NUM_FEATURES, 1, 23);
+    for(int gen=0; gen<6; ++gen){
+        for(auto &g : pop.genomes) g.fitness = (double)(g.contentHash() % 1000);
+        pop.epoch(4);
+    }
+    for(auto &g : pop.genomes) g.fitness = (double)(g.contentHash() % 1000) / 7;
+    const std::string path = "core_test_checkpoint.bin";
+    std::string error;
+    CHECK(neat::saveCheckpoint(pop, path, &error), "saveCheckpoint: " << error);
+
+    int pooled = 0;
+    neat::Population loaded(5, PlacementBuffer::NUM_FEATURES, 1, 1);
+    loaded.parallelFor = [&pooled](int n, const std::function<void(int)> &body){ ++pooled; for(int i=0; i<n; ++i) body(i); };
+    CHECK(neat::loadCheckpoint(path, loaded, &error), "loadCheckpoint: " << error);
+    std::remove(path.c_str());
+    CHECK(loaded.globalInnov == pop.globalInnov && loaded.nextNodeId == pop.nextNodeId, "checkpoint counters differ");
+    CHECK(loaded.genomes.size() == pop.genomes.size(), "checkpoint genome count differs");
+    for(size_t i=0; i<pop.genomes.size() && i<loaded.genomes.size(); ++i){
+        CHECK(loaded.genomes[i].contentHash() == pop.genomes[i].contentHash(), "checkpoint genome " << i << " differs");
+        CHECK(loaded.genomes[i].fitness == pop.genomes[i].fitness, "checkpoint fitness " << i << " differs");
+    }
+    loaded.epoch(4);
+    CHECK(pooled > 0, "loadCheckpoint dropped the caller's parallelFor");
+}
+
+// Structure grows fast and fit genomes breed many children; every child's genes must still sit
+// in the single block epoch() sized its arena to.
+void testArenaBlock(){
+    neat::Population pop(150, PlacementBuffer::NUM_FEATURES, 1, 17);
+    pop.addNodeRate = 0.5;
+    pop.addLinkRate = 0.8;
+    for(int gen=0; gen<20; ++gen){
+        for(size_t i=0; i<pop.genomes.size(); ++i) pop.genomes[i].fitness = i < 3 ? 1000.0 : (double)(pop.genomes[i].contentHash() % 100);
+        pop.epoch(4);
+        const char *begin = (const char*)pop.arenaBlocks[pop.front].get();
+        const char *end = begin + pop.arenaBlockCount[pop.front] * sizeof(std::max_align_t);
+        auto inside = [&](const void *p){ return p == nullptr || ((const char*)p >= begin && (const char*)p < end); };
+        int outside = 0;
+        for(const auto &g : pop.genomes) outside += !inside(g.nodes.data()) + !inside(g.conns.data());
+        CHECK(outside == 0, "generation " << gen << ": " << outside << " gene vectors outside the arena block");
+    }
+}
+
+// Several threads submitting small batches at once, so workers often finish a batch before its
+// submitter returns. Every index must run exactly once.
+void testConcurrentSubmit(){
+    ThreadPool pool(4);
+    const int submitters = 4, batches = 2000;
+    std::vector<std::vector<int>> runs(submitters, std::vector<int>(batches * 3, 0));
+    std::vector<std::vector<std::shared_ptr<ThreadPool::Batch>>> pending(submitters);
+    std::vector<std::thread> threads;
+    for(int s=0; s<submitters; ++s){
+        threads.emplace_back([&, s]{
+            for(int b=0; b<batches; ++b){
+                int *slots = &runs[s][b * 3];
+                auto batch = pool.submit(1 + b % 3, [slots](int i, int){ ++slots[i]; });
+                if(b % 2) batch->wait(); // odd batches waited on at once, even ones at the end
+                else pending[s].push_back(batch);
+            }
+        });
+    }
+    for(auto &t : threads) t.join();
+    for(auto &handles : pending) for(auto &batch : handles) batch->wait();
+    for(int s=0; s<submitters; ++s)
+        for(int b=0; b<batches; ++b)
+            for(int i=0; i<3; ++i) CHECK(runs[s][b * 3 + i] == (i < 1 + b % 3), "concurrent submit ran a task other than once");
+}
+
+int main(){
+    std::vector<Board> boards = randomBoards(40);
+    testDropRow(boards);
+    testIncrementalFeatures(boards);
+    testQuantizedSigmoid();
+    std::vector<neat::Genome> genomes = randomGenomes(60);
+    testPhenotype(genomes);
+    testBatch(genomes, boards);
+    testParallelEpoch();
+    testArenaBlock();
+    testCheckpointRoundTrip();
+    testConcurrentSubmit();
+    std::cout << boards.size() << " boards, " << (failures ? std::to_string(failures) + " failures" : std::string("all checks passed")) << std::endl;
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,80 @@
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "game/Bag.h"
+#include "game/Board.h"
+#include "game/Features.h"
+
+// Differential test of every SIMD feature kernel the CPU supports against scalarKernel, on random
+// column sets and on the column bits of boards from seeded games, with and without cleared rows.
+
+int failures = 0;
+
+void compare(const features::NamedKernel &k, const uint32_t *cols, uint32_t cleared, const std::string &where){
+    features::Profile want, got;
+    features::scalarKernel(cols, cleared, Board::HEIGHT, want);
+    k.kernel(cols, cleared, Board::HEIGHT, got);
+    if(want.heights == got.heights && want.holes == got.holes && want.aggregateHeight == got.aggregateHeight
+       && want.totalHoles == got.totalHoles && want.bumpiness == got.bumpiness) return;
+    if(++failures <= 10)
+        std::cerr << "FAIL " << k.name << " on " << where << ", cleared 0x" << std::hex << cleared << std::dec
+                  << ": aggregate height " << got.aggregateHeight << " vs " << want.aggregateHeight
+                  << ", holes " << got.totalHoles << " vs " << want.totalHoles
+                  << ", bumpiness " << got.bumpiness << " vs " << want.bumpiness << std::endl;
+}
+
+// Column bits of a board: bit y of column x set when cell (x, y) is filled.
+std::vector<uint32_t> columnsOf(const Board &b){
+    std::vector<uint32_t> cols(features::COLUMNS, 0);
+    for(int y=0; y<Board::HEIGHT; ++y)
+        for(int x=0; x<Board::WIDTH; ++x)
+            if(b.isCell(x, y)) cols[x] |= 1u << y;
+    return cols;
+}
+
+int main(){
+    std::vector<features::NamedKernel> kernels = features::simdKernels();
+    std::cout << "selected kernel: " << features::kernelName() << ", testing";
+    for(const auto &k : kernels) std::cout << " " << k.name;
+    std::cout << (kernels.empty() ? " nothing (no SIMD kernels on this CPU)" : "") << std::endl;
+
+    std::mt19937 rng(2024);
+    for(int trial=0; trial<20000; ++trial){
+        uint32_t cols[features::COLUMNS];
+        int surface = trial % (Board::HEIGHT + 1);
+        for(auto &col : cols){
+            col = rng() & ((1u << Board::HEIGHT) - 1);
+            col &= ~((1u << (rng() % (surface + 1))) - 1);
+        }
+        uint32_t cleared = 0;
+        for(int n = trial % 5; n > 0; --n) cleared |= 1u << (rng() % Board::HEIGHT);
+        for(const auto &k : kernels) compare(k, cols, cleared, "random trial " + std::to_string(trial));
+    }
+
+    PlacementBuffer placements;
+    int boards = 0;
+    for(int seed=0; seed<20; ++seed){
+        Board b;
+        Bag bag(seed);
+        GarbageHoles holes(seed);
+        for(int piece=1; piece<=300 && !b.isGameOver(); ++piece, ++boards){
+            std::vector<uint32_t> cols = columnsOf(b);
+            uint32_t full = 0;
+            for(int y=0; y<Board::HEIGHT; ++y) if(b.rows()[y] == Board::FULL_ROW) full |= 1u << y;
+            uint32_t lowRows = (rng() % 16) << (Board::HEIGHT - 4);
+            for(const auto &k : kernels){
+                std::string where = "seed " + std::to_string(seed) + " piece " + std::to_string(piece);
+                compare(k, cols.data(), 0, where);
+                compare(k, cols.data(), full | lowRows, where);
+            }
+            Tetromino tet(bag.next());
+            b.allPossiblePlacements(tet, placements);
+            if(placements.empty()) break;
+            b.applyPlacement(placements[(int)(rng() % placements.size())], tet);
+            if(piece % 7 == 0) b.addGarbageLine(holes.next(Board::WIDTH));
+        }
+    }
+    std::cout << boards << " game boards, " << (failures ? std::to_string(failures) + " mismatches" : std::string("all kernels agree with scalar")) << std::endl;
+    return failures ? 1 : 0;
+}